@@ -0,0 +1,380 @@
+/*
+  ==============================================================================
+
+    BodyResonator.cpp
+    Created: 17 Oct 2026 7:34:18pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "BodyResonator.h"
+
+//===============================================================================
+void PartitionedConvolver::prepare(const float* ir, int start, int end, int newBlockSize)
+{
+    jassert(isPowerOfTwo(newBlockSize) && start >= newBlockSize && end > start);
+
+    blockSize = newBlockSize;
+    fftSize = 2 * blockSize;
+    numBins = blockSize + 1;
+    fft = std::make_unique<dsp::FFT>(roundToInt(std::log2((double)fftSize)));
+
+    // Overlap-save output is one block late, so partition k of the filter run
+    // here holds taps [k * blockSize + blockSize, ...) of the IR
+    firstPartition = (start - blockSize) / blockSize;
+    numPartitions = (end - start + blockSize - 1) / blockSize;
+    historyDepth = firstPartition + numPartitions;
+
+    distributed = firstPartition > 0;
+    numWorkSteps = numPartitions + 2;
+
+    const size_t spectrumFloats = (size_t)numBins * 2;
+
+    irSpectra.allocate(spectrumFloats * (size_t)numPartitions, true);
+    inputSpectra.allocate(spectrumFloats * (size_t)historyDepth, true);
+    inputWindow.allocate((size_t)fftSize, true);
+    fftBuffer.allocate((size_t)fftSize * 2, true);
+    accumulator.allocate(spectrumFloats, true);
+    outputBlock.allocate((size_t)blockSize, true);
+    nextOutputBlock.allocate((size_t)blockSize, true);
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        const int first = start + p * blockSize;
+        const int count = jmin(blockSize, end - first);
+
+        FloatVectorOperations::clear(fftBuffer.get(), fftSize * 2);
+        FloatVectorOperations::copy(fftBuffer.get(), ir + first, count);
+        fft->performRealOnlyForwardTransform(fftBuffer.get(), true);
+
+        FloatVectorOperations::copy(irSpectra.get() + spectrumFloats * (size_t)p, fftBuffer.get(), (int)spectrumFloats);
+    }
+
+    reset();
+}
+
+void PartitionedConvolver::reset() noexcept
+{
+    FloatVectorOperations::clear(inputSpectra.get(), numBins * 2 * historyDepth);
+    FloatVectorOperations::clear(inputWindow.get(), fftSize);
+    FloatVectorOperations::clear(outputBlock.get(), blockSize);
+    FloatVectorOperations::clear(nextOutputBlock.get(), blockSize);
+
+    // The first distributed block transforms this as its (silent) input window
+    FloatVectorOperations::clear(fftBuffer.get(), fftSize * 2);
+
+    historyIndex = 0;
+    position = 0;
+    workDone = 0;
+}
+
+void PartitionedConvolver::process(const float* input, float* output, int numSamples) noexcept
+{
+    while (numSamples > 0)
+    {
+        const int count = jmin(numSamples, blockSize - position);
+
+        FloatVectorOperations::copy(inputWindow.get() + blockSize + position, input, count);
+        FloatVectorOperations::add(output, outputBlock.get() + position, count);
+
+        position += count;
+        input += count;
+        output += count;
+        numSamples -= count;
+
+        if (distributed)
+            doWorkUpTo((int)((int64)numWorkSteps * position / blockSize));
+
+        if (position == blockSize)
+        {
+            if (distributed)
+                finishDistributedBlock();
+            else
+                processBlock();
+
+            position = 0;
+        }
+    }
+}
+
+void PartitionedConvolver::processBlock() noexcept
+{
+    // Spectrum of the last two blocks goes into the history ring, then the sum of
+    // each partition's spectrum times the input spectrum from that many blocks ago
+    loadInputWindow();
+    transformInput();
+
+    for (int p = 0; p < numPartitions; ++p)
+        accumulatePartition(p, historyIndex);
+
+    transformOutput(outputBlock.get());
+
+    historyIndex = historyIndex + 1 == historyDepth ? 0 : historyIndex + 1;
+}
+
+void PartitionedConvolver::doWorkUpTo(int step) noexcept
+{
+    // While block k+1 comes in, build the output for block k+2: the input window
+    // that ended with block k is already in fftBuffer, and with firstPartition > 0
+    // the newest spectrum the partitions need is that one
+    const int newestSlot = historyIndex + 1 == historyDepth ? 0 : historyIndex + 1;
+
+    for (; workDone < step; ++workDone)
+    {
+        if (workDone == 0)
+            transformInput();
+        else if (workDone <= numPartitions)
+            accumulatePartition(workDone - 1, newestSlot);
+        else
+            transformOutput(nextOutputBlock.get());
+    }
+}
+
+void PartitionedConvolver::finishDistributedBlock() noexcept
+{
+    doWorkUpTo(numWorkSteps);
+
+    outputBlock.swapWith(nextOutputBlock);
+    historyIndex = historyIndex + 1 == historyDepth ? 0 : historyIndex + 1;
+
+    loadInputWindow();
+    workDone = 0;
+}
+
+void PartitionedConvolver::loadInputWindow() noexcept
+{
+    FloatVectorOperations::copy(fftBuffer.get(), inputWindow.get(), fftSize);
+    FloatVectorOperations::clear(fftBuffer.get() + fftSize, fftSize);
+
+    FloatVectorOperations::copy(inputWindow.get(), inputWindow.get() + blockSize, blockSize);
+}
+
+void PartitionedConvolver::transformInput() noexcept
+{
+    const size_t spectrumFloats = (size_t)numBins * 2;
+
+    fft->performRealOnlyForwardTransform(fftBuffer.get(), true);
+    FloatVectorOperations::copy(inputSpectra.get() + spectrumFloats * (size_t)historyIndex, fftBuffer.get(), (int)spectrumFloats);
+
+    FloatVectorOperations::clear(accumulator.get(), (int)spectrumFloats);
+}
+
+void PartitionedConvolver::accumulatePartition(int partition, int newestSlot) noexcept
+{
+    const size_t spectrumFloats = (size_t)numBins * 2;
+    int slot = newestSlot - (firstPartition + partition);
+
+    if (slot < 0)
+        slot += historyDepth;
+
+    const float* x = inputSpectra.get() + spectrumFloats * (size_t)slot;
+    const float* h = irSpectra.get() + spectrumFloats * (size_t)partition;
+    float* acc = accumulator.get();
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const float xr = x[2 * bin], xi = x[2 * bin + 1];
+        const float hr = h[2 * bin], hi = h[2 * bin + 1];
+
+        acc[2 * bin] += xr * hr - xi * hi;
+        acc[2 * bin + 1] += xr * hi + xi * hr;
+    }
+}
+
+void PartitionedConvolver::transformOutput(float* destination) noexcept
+{
+    FloatVectorOperations::copy(fftBuffer.get(), accumulator.get(), numBins * 2);
+    fft->performRealOnlyInverseTransform(fftBuffer.get());
+
+    // Overlap-save: only the second half is free of wrap-around
+    FloatVectorOperations::copy(destination, fftBuffer.get() + blockSize, blockSize);
+}
+
+//===============================================================================
+void BodyConvolver::prepare(const float* ir, int irLength)
+{
+    head.fill(0.0f);
+
+    // Taps are stored reversed so the FIR is a straight dot product with the history
+    for (int i = 0; i < jmin(headSize, irLength); ++i)
+        head[(size_t)(headSize - 1 - i)] = ir[i];
+
+    segments.clear();
+
+    // (block size, first tap): each segment ends where the next one starts
+    const std::pair<int, int> layout[] = { { 64, headSize }, { 1024, 2048 }, { 8192, 16384 } };
+    const int numLayouts = (int)std::size(layout);
+
+    for (int i = 0; i < numLayouts; ++i)
+    {
+        const int start = layout[i].second;
+        const int end = i + 1 < numLayouts ? jmin(irLength, layout[i + 1].second) : irLength;
+
+        if (start >= end)
+            break;
+
+        segments.add(new PartitionedConvolver())->prepare(ir, start, end, layout[i].first);
+    }
+
+    reset();
+}
+
+void BodyConvolver::reset() noexcept
+{
+    history.fill(0.0f);
+    historyPosition = 0;
+
+    for (auto* segment : segments)
+        segment->reset();
+}
+
+void BodyConvolver::process(const float* input, float* output, int numSamples) noexcept
+{
+    // Direct form head, zero latency
+    for (int n = 0; n < numSamples; ++n)
+    {
+        // Written twice so the newest headSize inputs are always contiguous
+        history[(size_t)historyPosition] = history[(size_t)(historyPosition + headSize)] = input[n];
+        historyPosition = historyPosition + 1 == headSize ? 0 : historyPosition + 1;
+
+        const float* x = history.data() + historyPosition;
+        float sum = 0.0f;
+
+        for (int k = 0; k < headSize; ++k)
+            sum += head[(size_t)k] * x[k];
+
+        output[n] = sum;
+    }
+
+    for (auto* segment : segments)
+        segment->process(input, output, numSamples);
+}
+
+//===============================================================================
+bool BodyResonator::prepare(const AudioBuffer<float>& impulseResponse, double impulseSampleRate,
+                            double sampleRate, int maxBlockSize)
+{
+    convolvers.clear();
+    impulseLength = 0;
+
+    if (impulseResponse.getNumSamples() == 0 || impulseResponse.getNumChannels() == 0 || sampleRate <= 0.0)
+        return false;
+
+    const double ratio = impulseSampleRate > 0.0 ? impulseSampleRate / sampleRate : 1.0;
+    const int maxLength = (int)(maxImpulseSeconds * sampleRate);
+
+    impulseLength = jmin(maxLength, (int)std::ceil(impulseResponse.getNumSamples() / ratio));
+
+    HeapBlock<float> resampled((size_t)impulseLength, true);
+
+    for (int channel = 0; channel < jmin(2, impulseResponse.getNumChannels()); ++channel)
+    {
+        const float* source = impulseResponse.getReadPointer(channel);
+
+        if (ratio == 1.0)
+        {
+            FloatVectorOperations::copy(resampled.get(), source, impulseLength);
+        }
+        else
+        {
+            // Scaled so the body's gain doesn't depend on the IR's rate
+            LagrangeInterpolator interpolator;
+            const int available = impulseResponse.getNumSamples();
+            const int produced = jmin(impulseLength, (int)((double)available / ratio));
+
+            FloatVectorOperations::clear(resampled.get(), impulseLength);
+            interpolator.process(ratio, source, resampled.get(), produced, available, 0);
+            FloatVectorOperations::multiply(resampled.get(), (float)ratio, impulseLength);
+        }
+
+        convolvers.add(new BodyConvolver())->prepare(resampled.get(), impulseLength);
+    }
+
+    scratchSize = jmax(1, maxBlockSize);
+    dry.allocate((size_t)scratchSize, true);
+    preciseDry.allocate((size_t)scratchSize, true);
+    wet.allocate((size_t)scratchSize * 2, true);
+    gains.allocate((size_t)scratchSize, true);
+
+    wetGain.reset(sampleRate, 0.02);
+    wetGain.setCurrentAndTargetValue(0.0f);
+
+    return true;
+}
+
+void BodyResonator::reset() noexcept
+{
+    for (auto* convolver : convolvers)
+        convolver->reset();
+}
+
+template <typename SampleType>
+void BodyResonator::process(AudioBuffer<SampleType>& buffer, int numSamples, float wetMix) noexcept
+{
+    if (convolvers.isEmpty())
+        return;
+
+    const int numChannels = buffer.getNumChannels();
+    wetGain.setTargetValue(wetMix);
+
+    for (int start = 0; start < numSamples; start += scratchSize)
+    {
+        const int chunk = jmin(scratchSize, numSamples - start);
+
+        const SampleType* drySignal;
+
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            FloatVectorOperations::copy(dry.get(), buffer.getReadPointer(0, start), chunk);
+            drySignal = dry.get();
+        }
+        else
+        {
+            FloatVectorOperations::copy(preciseDry.get(), buffer.getReadPointer(0, start), chunk);
+
+            for (int n = 0; n < chunk; ++n)
+                dry[n] = (float)preciseDry[n];
+
+            drySignal = preciseDry.get();
+        }
+
+        for (int i = 0; i < convolvers.size(); ++i)
+            convolvers.getUnchecked(i)->process(dry.get(), wet.get() + (size_t)i * (size_t)scratchSize, chunk);
+
+        const bool smoothing = wetGain.isSmoothing();
+
+        if (smoothing)
+            for (int n = 0; n < chunk; ++n)
+                gains[n] = wetGain.getNextValue();
+
+        const float mix = wetGain.getCurrentValue();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            // Mono IR feeds every channel, a stereo one left/right (and left again for any extras)
+            const int irChannel = channel < convolvers.size() ? channel : 0;
+            const float* wetChannel = wet.get() + (size_t)irChannel * (size_t)scratchSize;
+            SampleType* out = buffer.getWritePointer(channel, start);
+
+            if (smoothing)
+            {
+                for (int n = 0; n < chunk; ++n)
+                    out[n] = drySignal[n] + (SampleType)gains[n] * ((SampleType)wetChannel[n] - drySignal[n]);
+            }
+            else if constexpr (std::is_same_v<SampleType, float>)
+            {
+                FloatVectorOperations::copyWithMultiply(out, dry.get(), 1.0f - mix, chunk);
+                FloatVectorOperations::addWithMultiply(out, wetChannel, mix, chunk);
+            }
+            else
+            {
+                for (int n = 0; n < chunk; ++n)
+                    out[n] = drySignal[n] * (double)(1.0f - mix) + (double)wetChannel[n] * (double)mix;
+            }
+        }
+    }
+}
+
+template void BodyResonator::process(AudioBuffer<float>&, int, float) noexcept;
+template void BodyResonator::process(AudioBuffer<double>&, int, float) noexcept;
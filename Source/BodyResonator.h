@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    BodyResonator.h
+    Created: 17 Oct 2026 7:34:18pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// Uniformly partitioned overlap-save convolution of one segment of an impulse
+// response. Output comes out exactly blockSize samples late, so the segment
+// must start at least that far into the IR.
+//
+// A segment that starts a whole block further in than that doesn't need the
+// newest input block for its next output, so its work is time-distributed: the
+// forward FFT, each partition's multiply-add and the inverse FFT run as
+// separate steps, paced by how far into the current block the input is, and
+// the result is swapped in at the block boundary. No single callback then pays
+// for a whole 8192-sample block. The output is the same either way.
+//===============================================================================
+class PartitionedConvolver
+{
+public:
+    // Covers taps [start, end) of ir. Allocates.
+    void prepare(const float* ir, int start, int end, int blockSize);
+    void reset() noexcept;
+
+    // Adds the segment's contribution for numSamples of input into output
+    void process(const float* input, float* output, int numSamples) noexcept;
+
+private:
+    // Everything at the block boundary, for segments without the spare block
+    void processBlock() noexcept;
+
+    // Time-distributed steps; doWorkUpTo runs them until workDone reaches step
+    void doWorkUpTo(int step) noexcept;
+    void finishDistributedBlock() noexcept;
+
+    // Shared by both: window into fftBuffer, its spectrum into the history ring,
+    // one partition's multiply-add, and the accumulated spectrum back out
+    void loadInputWindow() noexcept;
+    void transformInput() noexcept;
+    void accumulatePartition(int partition, int newestSlot) noexcept;
+    void transformOutput(float* destination) noexcept;
+
+    std::unique_ptr<dsp::FFT> fft;
+    int blockSize = 0, fftSize = 0, numBins = 0;
+
+    // Leading partitions that are all zero (segment starts past blockSize) are
+    // skipped by reading further back in the input spectra instead
+    int firstPartition = 0, numPartitions = 0, historyDepth = 0;
+
+    HeapBlock<float> irSpectra;      // numPartitions x numBins complex (interleaved)
+    HeapBlock<float> inputSpectra;   // historyDepth x numBins complex, ring
+    HeapBlock<float> inputWindow;    // previous block then current block
+    HeapBlock<float> fftBuffer, accumulator, outputBlock;
+    HeapBlock<float> nextOutputBlock;    // time-distributed only: being built for the next block
+
+    int historyIndex = 0;
+    int position = 0;
+
+    bool distributed = false;
+    int numWorkSteps = 0;    // forward FFT, one per partition, inverse FFT
+    int workDone = 0;
+};
+
+//===============================================================================
+// Zero latency convolution of one IR channel: the first headSize taps as a
+// direct form FIR, then partitioned segments whose block size grows with their
+// distance into the IR (64 / 1024 / 8192), each block size no larger than the
+// part of the IR in front of it, so no segment adds delay.
+//===============================================================================
+class BodyConvolver
+{
+public:
+    static constexpr int headSize = 64;
+
+    void prepare(const float* ir, int irLength);
+    void reset() noexcept;
+
+    // Writes (not adds) the wet signal
+    void process(const float* input, float* output, int numSamples) noexcept;
+
+private:
+    std::array<float, headSize> head{};
+    std::array<float, 2 * headSize> history{};
+    int historyPosition = 0;
+
+    OwnedArray<PartitionedConvolver> segments;
+};
+
+//===============================================================================
+// Commuted synthesis body: the voice sum convolved with a body impulse
+// response (mono or stereo), once for the whole synth rather than per voice.
+//===============================================================================
+class BodyResonator
+{
+public:
+    static constexpr double maxImpulseSeconds = 10.0;
+
+    // Message thread. Resamples the IR to sampleRate if needed and builds the
+    // convolvers; false if the IR is empty.
+    bool prepare(const AudioBuffer<float>& impulseResponse, double impulseSampleRate,
+                 double sampleRate, int maxBlockSize);
+    void reset() noexcept;
+
+    // Audio thread. Channel 0 holds the dry mono voice sum (every channel is the
+    // same before this); each output channel becomes dry/wet mixed with its IR
+    // channel. Changes to wetMix are ramped. The convolution itself runs in float;
+    // for a double buffer the dry signal and the mix stay double.
+    template <typename SampleType>
+    void process(AudioBuffer<SampleType>& buffer, int numSamples, float wetMix) noexcept;
+
+    int getImpulseLength() const noexcept { return impulseLength; }
+
+private:
+    OwnedArray<BodyConvolver> convolvers;
+    HeapBlock<float> dry, wet, gains;
+    HeapBlock<double> preciseDry;
+    int scratchSize = 0;
+
+    SmoothedValue<float> wetGain;
+    int impulseLength = 0;
+};
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    Excitation.cpp
+    Created: 19 Oct 2026 11:12:40am
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "Excitation.h"
+
+//===============================================================================
+template <typename SampleType>
+void PluckExcitation<SampleType>::fill(SampleType* destination, int length, float position, int64) noexcept
+{
+    const int peak = (int)std::floor(position);
+
+    // First segment: rising ramp (0 to 1)
+    for (int i = 0; i <= peak && i < length; ++i)
+        destination[i] = static_cast<SampleType>(i) / position;
+
+    // Second segment: falling ramp (1 to 0)
+    for (int i = peak + 1; i < length; ++i)
+        destination[i] = static_cast<SampleType>(length - 1 - i) / (static_cast<SampleType>(length - 1) - position);
+}
+
+template <typename SampleType>
+void StrikeExcitation<SampleType>::fill(SampleType* destination, int length, float position, int64) noexcept
+{
+    // A sixteenth of the string either side, but always a few samples wide
+    const double halfWidth = jmax(2.0, (double)length / 16.0);
+
+    for (int i = 0; i < length; ++i)
+    {
+        const double x = ((double)i - (double)position) / halfWidth;
+        destination[i] = std::abs(x) < 1.0 ? (SampleType)(0.5 * (1.0 + std::cos(MathConstants<double>::pi * x))) : SampleType(0);
+    }
+}
+
+template <typename SampleType>
+void NoiseExcitation<SampleType>::fill(SampleType* destination, int length, float, int64 seed) noexcept
+{
+    Random random(seed);
+    double sum = 0.0;
+
+    for (int i = 0; i < length; ++i)
+    {
+        destination[i] = (SampleType)(random.nextFloat() * 2.0f - 1.0f);
+        sum += (double)destination[i];
+    }
+
+    // No DC, or the string would start with an offset it only loses through the loss filter
+    if (length > 0)
+        FloatVectorOperations::add(destination, (SampleType)(-sum / length), length);
+}
+
+template <typename SampleType>
+void Excitation<SampleType>::fill(ExcitationType type, SampleType* destination, int length, float position, int64 seed) noexcept
+{
+    using Fill = void (*)(SampleType*, int, float, int64) noexcept;
+
+    static constexpr Fill shapes[] =
+    {
+        &PluckExcitation<SampleType>::fill,
+        &StrikeExcitation<SampleType>::fill,
+        &NoiseExcitation<SampleType>::fill
+    };
+
+    shapes[jlimit(0, (int)std::size(shapes) - 1, (int)type)](destination, length, position, seed);
+}
+
+//===============================================================================
+template struct PluckExcitation<float>;
+template struct PluckExcitation<double>;
+template struct StrikeExcitation<float>;
+template struct StrikeExcitation<double>;
+template struct NoiseExcitation<float>;
+template struct NoiseExcitation<double>;
+template struct Excitation<float>;
+template struct Excitation<double>;
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    Excitation.h
+    Created: 19 Oct 2026 11:12:40am
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// Shape the string starts from at note-on, written into logical 0..L-1 of a
+// rail before WaveguideString::start() splits it between the two waves.
+//===============================================================================
+enum class ExcitationType
+{
+    Pluck = 0,  // triangle peaking at the pluck position
+    Strike,     // raised cosine bump around the pluck position, like a felt hammer
+    Noise       // white noise burst, Karplus-Strong style
+};
+
+// One policy per shape. position is in samples along the string; seed only
+// matters to the noise, which is the same for the same seed
+template <typename SampleType>
+struct PluckExcitation
+{
+    static void fill(SampleType* destination, int length, float position, int64 seed) noexcept;
+};
+
+template <typename SampleType>
+struct StrikeExcitation
+{
+    static void fill(SampleType* destination, int length, float position, int64 seed) noexcept;
+};
+
+template <typename SampleType>
+struct NoiseExcitation
+{
+    static void fill(SampleType* destination, int length, float position, int64 seed) noexcept;
+};
+
+template <typename SampleType>
+struct Excitation
+{
+    // Looks the shape up in a table of the policies above; it only runs at
+    // note-on so it's never part of a render loop
+    static void fill(ExcitationType type, SampleType* destination, int length, float position, int64 seed) noexcept;
+};
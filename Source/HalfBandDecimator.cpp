@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    HalfBandDecimator.cpp
+    Created: 17 Oct 2026 5:06:52pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "HalfBandDecimator.h"
+
+//===============================================================================
+template <typename SampleType>
+const typename HalfBandDecimator<SampleType>::Coefficients& HalfBandDecimator<SampleType>::getCoefficients()
+{
+    static const auto coefficients = []
+    {
+        // Zeroth order modified Bessel function for the Kaiser window
+        auto besselI0 = [](double x)
+        {
+            double sum = 1.0, term = 1.0;
+
+            for (int k = 1; k < 32; ++k)
+            {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+
+            return sum;
+        };
+
+        constexpr double beta = 8.0;
+        std::array<double, numPairs> taps{};
+        double sum = 0.5;
+
+        for (int i = 0; i < numPairs; ++i)
+        {
+            const int offset = 2 * i + 1;
+            const double x = MathConstants<double>::pi * offset * 0.5;
+            const double ratio = (double)offset / (double)centre;
+            const double window = besselI0(beta * std::sqrt(jmax(0.0, 1.0 - ratio * ratio))) / besselI0(beta);
+
+            taps[(size_t)i] = 0.5 * std::sin(x) / x * window;
+            sum += 2.0 * taps[(size_t)i];
+        }
+
+        // Unity gain at DC
+        Coefficients result;
+        result.centre = (SampleType)(0.5 / sum);
+
+        for (int i = 0; i < numPairs; ++i)
+            result.pairs[(size_t)i] = (SampleType)(taps[(size_t)i] / sum);
+
+        return result;
+    }();
+
+    return coefficients;
+}
+
+//===============================================================================
+template <typename SampleType>
+void HalfBandDecimator<SampleType>::reset() noexcept
+{
+    line.fill(SampleType(0));
+    position = 0;
+}
+
+template <typename SampleType>
+void HalfBandDecimator<SampleType>::process(const SampleType* input, SampleType* output, int numOutputs) noexcept
+{
+    const auto& c = getCoefficients();
+
+    for (int m = 0; m < numOutputs; ++m)
+    {
+        // Reading both inputs before writing makes in-place use safe
+        const SampleType a = input[2 * m];
+        const SampleType b = input[2 * m + 1];
+
+        push(a);
+        push(b);
+
+        // Oldest to newest window of the last numTaps inputs
+        const SampleType* w = line.data() + position;
+
+        SampleType y = c.centre * w[centre];
+
+        for (int i = 0; i < numPairs; ++i)
+            y += c.pairs[(size_t)i] * (w[centre - (2 * i + 1)] + w[centre + (2 * i + 1)]);
+
+        output[m] = y;
+    }
+}
+
+//===============================================================================
+template class HalfBandDecimator<float>;
+template class HalfBandDecimator<double>;
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    HalfBandDecimator.h
+    Created: 17 Oct 2026 5:06:52pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// 2:1 decimator built on a linear phase half-band FIR (Kaiser windowed sinc).
+//
+// Every other tap of a half-band filter is zero, so in polyphase form each
+// output only costs the centre tap plus one multiply per symmetric pair of
+// odd taps, and nothing is computed for the samples that are thrown away.
+// Two in series give 4:1. Runs at the precision of the string feeding it.
+//===============================================================================
+template <typename SampleType>
+class HalfBandDecimator
+{
+public:
+    static constexpr int numTaps = 31;
+    static constexpr int centre = numTaps / 2;
+    static constexpr int numPairs = (centre + 1) / 2;   // odd offsets 1, 3, .. centre
+
+    void reset() noexcept;
+
+    // Reads 2 * numOutputs samples from input. output may be the same buffer.
+    void process(const SampleType* input, SampleType* output, int numOutputs) noexcept;
+
+private:
+    struct Coefficients
+    {
+        SampleType centre = SampleType(0.5);
+        std::array<SampleType, numPairs> pairs{};
+    };
+
+    static const Coefficients& getCoefficients();
+
+    inline void push(SampleType sample) noexcept
+    {
+        // Written twice so the newest numTaps samples are always contiguous
+        line[(size_t)position] = line[(size_t)(position + numTaps)] = sample;
+        position = position + 1 == numTaps ? 0 : position + 1;
+    }
+
+    std::array<SampleType, 2 * numTaps> line{};
+    int position = 0;
+};
@@ -0,0 +1,244 @@
+/*
+  ==============================================================================
+
+    ModalResonator.cpp
+    Created: 17 Oct 2026 9:12:40pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "ModalResonator.h"
+
+// Same per-function target scheme as the StringBank kernels
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define MODAL_TARGET(isa) __attribute__((target(isa)))
+#else
+ #define MODAL_TARGET(isa)
+#endif
+
+namespace
+{
+    //===============================================================================
+    // Modes are taken W at a time and each group runs through a short chunk with
+    // its state in registers. Every lane accumulates into its own column of acc,
+    // so the k loops stay lane-wise and the horizontal sum happens once per sample
+    // per chunk rather than once per group.
+    template <int W>
+    forcedinline void renderModes(ModalResonator::ModeArrays& m, int numModes, float* output, int numSamples) noexcept
+    {
+        constexpr int chunkSize = 64;
+        const int numLanes = (numModes + W - 1) / W * W;
+
+        while (numSamples > 0)
+        {
+            const int chunk = jmin(chunkSize, numSamples);
+            float acc[chunkSize][W] = {};
+
+            for (int g = 0; g < numLanes; g += W)
+            {
+                float c1[W], c2[W], y1[W], y2[W];
+
+                for (int k = 0; k < W; ++k)
+                {
+                    c1[k] = m.c1[g + k]; c2[k] = m.c2[g + k];
+                    y1[k] = m.y1[g + k]; y2[k] = m.y2[g + k];
+                }
+
+                for (int n = 0; n < chunk; ++n)
+                {
+                    for (int k = 0; k < W; ++k)
+                    {
+                        const float y = c1[k] * y1[k] - c2[k] * y2[k];
+                        y2[k] = y1[k];
+                        y1[k] = y;
+                        acc[n][k] += y;
+                    }
+                }
+
+                for (int k = 0; k < W; ++k)
+                {
+                    m.y1[g + k] = y1[k];
+                    m.y2[g + k] = y2[k];
+                }
+            }
+
+            for (int n = 0; n < chunk; ++n)
+            {
+                float sum = 0.0f;
+
+                for (int k = 0; k < W; ++k)
+                    sum += acc[n][k];
+
+                output[n] = sum;
+            }
+
+            output += chunk;
+            numSamples -= chunk;
+        }
+    }
+
+    //===============================================================================
+    void renderScalar(ModalResonator::ModeArrays& m, int c, float* o, int n) noexcept { renderModes<1>(m, c, o, n); }
+
+   #if JUCE_INTEL
+    void renderSSE(ModalResonator::ModeArrays& m, int c, float* o, int n) noexcept { renderModes<4>(m, c, o, n); }
+
+    MODAL_TARGET("avx2")
+    void renderAVX2(ModalResonator::ModeArrays& m, int c, float* o, int n) noexcept { renderModes<8>(m, c, o, n); }
+
+    MODAL_TARGET("avx512f")
+    void renderAVX512(ModalResonator::ModeArrays& m, int c, float* o, int n) noexcept { renderModes<16>(m, c, o, n); }
+   #endif
+}
+
+//===============================================================================
+ModalResonator::ModalResonator()
+{
+    kernel = renderScalar;
+
+   #if JUCE_INTEL
+    if (SystemStats::hasAVX512F())
+        kernel = renderAVX512;
+    else if (SystemStats::hasAVX2())
+        kernel = renderAVX2;
+    else if (SystemStats::hasSSE2())
+        kernel = renderSSE;
+   #endif
+}
+
+void ModalResonator::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    for (auto* block : { &modes.c1, &modes.c2, &modes.y1, &modes.y2, &modes.amplitudeScale })
+        block->allocate((size_t)maxModes, true);
+
+    numModes = 0;
+    rmsAmplitude = 0.0f;
+}
+
+void ModalResonator::clear() noexcept
+{
+    // Unused lanes must stay all zero so they render silence
+    for (auto* block : { &modes.c1, &modes.c2, &modes.y1, &modes.y2, &modes.amplitudeScale })
+        FloatVectorOperations::clear(block->get(), maxModes);
+
+    numModes = 0;
+    rmsAmplitude = 0.0f;
+}
+
+template <typename Fn>
+void ModalResonator::forEachMode(const Settings& settings, double rate, Fn&& fn)
+{
+    if (settings.frequency <= 0.0f)
+        return;
+
+    const double maxFrequency = 0.45 * rate;
+    const double position = jlimit(0.02, 0.98, (double)settings.strikePosition);
+    const double B = jmax(0.0, (double)settings.inharmonicity);
+
+    for (int k = 1, numStarted = 0; numStarted < maxModes; ++k)
+    {
+        // Stiff bar/string partials; past the first one above Nyquist they only get higher
+        const double f = settings.frequency * k * std::sqrt(1.0 + B * k * k);
+
+        if (f >= maxFrequency)
+            break;
+
+        // Struck at position: modes with a node there aren't excited
+        const double amplitude = std::sin(k * MathConstants<double>::pi * position) / k;
+
+        if (std::abs(amplitude) < 1.0e-4)
+            continue;
+
+        fn(f, amplitude);
+        ++numStarted;
+    }
+}
+
+int ModalResonator::countModes(const Settings& settings, double rate)
+{
+    int count = 0;
+    forEachMode(settings, rate, [&count](double, double) { ++count; });
+    return count;
+}
+
+void ModalResonator::start(const Settings& settings)
+{
+    clear();
+
+    if (modes.c1.get() == nullptr)
+        return;
+
+    double totalAmplitude = 0.0;
+
+    forEachMode(settings, sampleRate, [&](double f, double amplitude)
+    {
+        const double T60 = jmax(1.0e-3, (double)settings.decaySeconds) / (1.0 + square(f / jmax(1.0f, settings.brightness)));
+        const double radius = std::pow(10.0, -3.0 / (T60 * sampleRate));
+        const double w = MathConstants<double>::twoPi * f / sampleRate;
+
+        // State set so the mode runs amplitude * radius^n * sin(w n) from n = 0,
+        // starting at zero so the onset doesn't click
+        const int i = numModes++;
+        modes.c1[i] = (float)(2.0 * radius * std::cos(w));
+        modes.c2[i] = (float)(radius * radius);
+        modes.y1[i] = (float)(-amplitude * std::sin(w) / radius);
+        modes.y2[i] = (float)(-amplitude * std::sin(2.0 * w) / (radius * radius));
+        modes.amplitudeScale[i] = (float)(1.0 / square(std::sin(w)));
+
+        totalAmplitude += std::abs(amplitude);
+    });
+
+    // Peak no louder than the waveguide's unit pluck
+    if (totalAmplitude > 0.0)
+    {
+        const float scale = (float)(1.0 / totalAmplitude);
+        FloatVectorOperations::multiply(modes.y1.get(), scale, numModes);
+        FloatVectorOperations::multiply(modes.y2.get(), scale, numModes);
+    }
+
+    cullBelow(0.0f);
+}
+
+void ModalResonator::process(float* output, int numSamples) noexcept
+{
+    kernel(modes, numModes, output, numSamples);
+}
+
+void ModalResonator::cullBelow(float floor) noexcept
+{
+    const float floorSquared = floor * floor;
+    double total = 0.0;
+
+    for (int i = 0; i < numModes;)
+    {
+        // Exact for a damped sinusoid: y1^2 - c1 y1 y2 + c2 y2^2 = (A r^n sin w)^2
+        const float y1 = modes.y1[i], y2 = modes.y2[i];
+        const float amplitudeSquared = (y1 * y1 - modes.c1[i] * y1 * y2 + modes.c2[i] * y2 * y2) * modes.amplitudeScale[i];
+
+        if (amplitudeSquared < floorSquared)
+        {
+            removeMode(i);
+            continue;
+        }
+
+        total += amplitudeSquared;
+        ++i;
+    }
+
+    rmsAmplitude = (float)std::sqrt(0.5 * total);
+}
+
+void ModalResonator::removeMode(int index) noexcept
+{
+    // Last mode moves into the gap and its lane is zeroed, so the active modes stay packed
+    const int last = --numModes;
+
+    for (auto* block : { &modes.c1, &modes.c2, &modes.y1, &modes.y2, &modes.amplitudeScale })
+    {
+        (*block)[index] = (*block)[last];
+        (*block)[last] = 0.0f;
+    }
+}
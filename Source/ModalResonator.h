@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    ModalResonator.h
+    Created: 17 Oct 2026 9:12:40pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// Modal alternative to the waveguide: a bank of damped second-order resonators,
+// one per partial, for stiff/inharmonic material.
+//
+// Modes are held as structure-of-arrays and advanced W at a time in vector
+// lanes (AVX-512 / AVX2 / SSE picked at runtime, scalar fallback). Modes above
+// Nyquist are never started and ones that decay below the floor are dropped,
+// so the cost follows what's still audible.
+//===============================================================================
+class ModalResonator
+{
+public:
+    // A multiple of the widest vector, so the lanes never need a scalar tail
+    static constexpr int maxModes = 256;
+
+    struct Settings
+    {
+        float frequency = 440.0f;
+        float inharmonicity = 0.0f;     // B in f_k = k f0 sqrt(1 + B k^2)
+        float strikePosition = 0.5f;    // 0..1 along the body, shapes mode amplitudes
+        float decaySeconds = 2.0f;      // T60 of the fundamental
+        float brightness = 15000.0f;    // Hz where T60 has halved
+    };
+
+    ModalResonator();
+
+    // Allocates the mode arrays, call before start()
+    void prepare(double sampleRate);
+
+    // Never allocates
+    void start(const Settings& settings);
+
+    // How many modes start() would run for these settings, without starting them
+    static int countModes(const Settings& settings, double rate);
+    void clear() noexcept;
+
+    // Writes (not adds) numSamples of the summed modes
+    void process(float* output, int numSamples) noexcept;
+
+    // Drops modes whose amplitude is below floor; the voice is done when none are left
+    void cullBelow(float floor) noexcept;
+
+    bool isActive() const noexcept { return numModes > 0; }
+    int getNumModes() const noexcept { return numModes; }
+    float getRmsAmplitude() const noexcept { return rmsAmplitude; }
+
+    struct ModeArrays
+    {
+        // y[n] = c1 y[n-1] - c2 y[n-2], amplitude folded into the state
+        HeapBlock<float> c1, c2, y1, y2;
+
+        // 1 / sin^2(w), turns the state into an amplitude estimate
+        HeapBlock<float> amplitudeScale;
+    };
+
+private:
+    using Kernel = void (*)(ModeArrays&, int, float*, int);
+
+    void removeMode(int index) noexcept;
+
+    // Calls fn(f, amplitude) for every partial start() runs, in order
+    template <typename Fn>
+    static void forEachMode(const Settings& settings, double rate, Fn&& fn);
+
+    ModeArrays modes;
+    Kernel kernel = nullptr;
+
+    double sampleRate = 44100.0;
+    int numModes = 0;
+    float rmsAmplitude = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModalResonator)
+};
@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    PerformanceCounters.cpp
+    Created: 18 Oct 2026 6:05:33pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "PerformanceCounters.h"
+
+//===============================================================================
+PerformanceCounters::Snapshot PerformanceCounters::getSnapshot() const noexcept
+{
+    Snapshot s;
+
+   #if PMS_PERFORMANCE_COUNTERS
+    const double secondsPerTick = 1.0 / (double)Time::getHighResolutionTicksPerSecond();
+    int64 blockTicks = 0, deadlineTicks = 0, voiceTicks = 0, noteOnTicks = 0;
+    float peakTicksPerVoiceSample = 0.0f;
+    int64 peakNoteOnTicks = 0;
+
+    const int used = numSlotsUsed.load(std::memory_order_acquire);
+
+    // Every field is read on its own, so a snapshot taken mid-block can mix that
+    // block's counts with the previous one's; fine for a display
+    for (int i = 0; i < used; ++i)
+    {
+        const auto& c = slots[(size_t)i];
+
+        const auto blocks = c.blocks.load(std::memory_order_relaxed);
+        const auto ticks = c.blockTicks.load(std::memory_order_relaxed);
+        const auto voice = c.voiceTicks.load(std::memory_order_relaxed);
+
+        if (i == audioCallbackSlot ? blocks > 0 : c.owner.load(std::memory_order_relaxed) != nullptr)
+            ++s.numThreads;
+
+        s.blocks += blocks;
+        s.missedDeadlines += c.missedDeadlines.load(std::memory_order_relaxed);
+        s.lastMissMs = jmax(s.lastMissMs, c.lastMissMs.load(std::memory_order_relaxed));
+        s.peakLoad = jmax(s.peakLoad, c.peakLoad.load(std::memory_order_relaxed));
+        s.peakActiveVoices = jmax(s.peakActiveVoices, c.peakActiveVoices.load(std::memory_order_relaxed));
+
+        blockTicks += ticks;
+        deadlineTicks += c.deadlineTicks.load(std::memory_order_relaxed);
+
+        if (i == audioCallbackSlot)
+        {
+            s.lastLoad = c.lastLoad.load(std::memory_order_relaxed);
+            s.activeVoices = c.activeVoices.load(std::memory_order_relaxed);
+        }
+
+        voiceTicks += voice;
+        s.voiceSamples += c.voiceSamples.load(std::memory_order_relaxed);
+        peakTicksPerVoiceSample = jmax(peakTicksPerVoiceSample, c.peakTicksPerVoiceSample.load(std::memory_order_relaxed));
+
+        s.noteOns += c.noteOns.load(std::memory_order_relaxed);
+        noteOnTicks += c.noteOnTicks.load(std::memory_order_relaxed);
+        peakNoteOnTicks = jmax(peakNoteOnTicks, c.peakNoteOnTicks.load(std::memory_order_relaxed));
+
+        // Voice time on the audio thread is already inside its block time
+        s.threadBusySeconds[i] = (double)(blocks > 0 ? ticks : voice) * secondsPerTick;
+    }
+
+    s.averageLoad = deadlineTicks > 0 ? (float)((double)blockTicks / (double)deadlineTicks) : 0.0f;
+
+    s.nsPerVoiceSample = s.voiceSamples > 0 ? (double)voiceTicks * secondsPerTick * 1.0e9 / (double)s.voiceSamples : 0.0;
+    s.peakNsPerVoiceSample = (double)peakTicksPerVoiceSample * secondsPerTick * 1.0e9;
+
+    s.averageNoteOnNs = s.noteOns > 0 ? (double)noteOnTicks * secondsPerTick * 1.0e9 / (double)s.noteOns : 0.0;
+    s.peakNoteOnNs = (double)peakNoteOnTicks * secondsPerTick * 1.0e9;
+   #endif
+
+    return s;
+}
+
+void PerformanceCounters::resetPeaks() noexcept
+{
+   #if PMS_PERFORMANCE_COUNTERS
+    // Races with the writers are harmless: at worst one peak survives the reset
+    for (auto& c : slots)
+    {
+        c.peakLoad.store(0.0f, std::memory_order_relaxed);
+        c.peakActiveVoices.store(0, std::memory_order_relaxed);
+        c.peakTicksPerVoiceSample.store(0.0f, std::memory_order_relaxed);
+        c.peakNoteOnTicks.store(0, std::memory_order_relaxed);
+    }
+   #endif
+}
+
+String PerformanceCounters::describe(const Snapshot& s)
+{
+    if (!enabled)
+        return "performance counters compiled out";
+
+    return "load " + String(s.lastLoad * 100.0f, 1) + "% (avg " + String(s.averageLoad * 100.0f, 1)
+         + "%, peak " + String(s.peakLoad * 100.0f, 1) + "%), "
+         + String(s.missedDeadlines) + "/" + String(s.blocks) + " blocks late, "
+         + String(s.activeVoices) + " voices (peak " + String(s.peakActiveVoices) + "), "
+         + String(s.nsPerVoiceSample, 1) + " ns/voice-sample (peak " + String(s.peakNsPerVoiceSample, 1) + "), "
+         + "note-on " + String(s.averageNoteOnNs / 1000.0, 1) + " us (peak " + String(s.peakNoteOnNs / 1000.0, 1) + "), "
+         + String(s.numThreads) + " thread(s)";
+}
@@ -0,0 +1,305 @@
+/*
+  ==============================================================================
+
+    PerformanceCounters.h
+    Created: 18 Oct 2026 6:05:33pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Set to 0 (e.g. in the Projucer's preprocessor definitions) to compile every
+// recording call down to nothing; the reader side then just returns zeros
+#ifndef PMS_PERFORMANCE_COUNTERS
+ #define PMS_PERFORMANCE_COUNTERS 1
+#endif
+
+//===============================================================================
+// Audio-thread instrumentation for finding out why a session xruns: block time
+// against the block's deadline, missed deadlines, voice render cost, active
+// voices and note-on cost.
+//
+// Every thread that records gets its own cache-line sized slot. The audio
+// callback's slot belongs to the processor, not to a thread: startBlock() points
+// whichever thread the host runs processBlock on at it, so hosts that move the
+// callback between threads don't use slots up. Render workers claim theirs
+// once with a compare-exchange, and every thread keeps its slot in a
+// thread_local, so recording never searches. A slot only ever has one writer at
+// a time, so recording is plain relaxed loads and stores, never a lock or an RMW
+// on shared data. Slots of workers that have exited are handed back with
+// releaseThread(). Readers (the editor's timer, a headless dump) sum the slots
+// whenever they like without blocking.
+//===============================================================================
+class PerformanceCounters
+{
+public:
+    static constexpr bool enabled = PMS_PERFORMANCE_COUNTERS != 0;
+    static constexpr int maxThreads = 16;
+
+    //===============================================================================
+    // Recording side. Call startTimer() before the work and pass what it returned
+
+    static int64 startTimer() noexcept
+    {
+       #if PMS_PERFORMANCE_COUNTERS
+        return Time::getHighResolutionTicks();
+       #else
+        return 0;
+       #endif
+    }
+
+    // Start of processBlock: from here on the calling thread records into the
+    // audio callback's slot. Returns startTimer() for recordBlock
+    int64 startBlock() noexcept;
+
+    // One processBlock of numSamples. The deadline is the block's own duration, so
+    // a miss means this block alone took longer than it plays for
+    void recordBlock(int64 startTicks, int numSamples, double sampleRate, int activeVoices) noexcept;
+
+    // numVoices strings rendered for numSamples; 0 voices adds to busy time only
+    void recordVoiceRender(int64 startTicks, int numVoices, int numSamples) noexcept;
+
+    // Whole note-on: voice search, stealing and the voice's startNote
+    void recordNoteOn(int64 startTicks) noexcept;
+
+    // Frees the slot of a worker that has stopped for good, for the next new thread
+    // to claim. What it recorded stays in the totals. Only call once the thread can
+    // no longer record
+    void releaseThread(Thread::ThreadID threadId) noexcept;
+
+    //===============================================================================
+    // Reader side, any thread
+
+    struct Snapshot
+    {
+        int64 blocks = 0;
+        int64 missedDeadlines = 0;
+        double lastMissMs = 0.0;        // Time::getMillisecondCounterHiRes() of the newest miss
+
+        float lastLoad = 0.0f;          // block time / deadline for the newest block
+        float peakLoad = 0.0f;          // since the last resetPeaks()
+        float averageLoad = 0.0f;       // over every block so far
+
+        int activeVoices = 0;
+        int peakActiveVoices = 0;
+
+        int64 voiceSamples = 0;
+        double nsPerVoiceSample = 0.0;
+        double peakNsPerVoiceSample = 0.0;
+
+        int64 noteOns = 0;
+        double averageNoteOnNs = 0.0;
+        double peakNoteOnNs = 0.0;
+
+        int numThreads = 0;                          // the audio callback and workers holding a slot right now
+        double threadBusySeconds[maxThreads] = {};   // block plus voice time per slot (0 is the audio callback)
+    };
+
+    Snapshot getSnapshot() const noexcept;
+    void resetPeaks() noexcept;
+
+    // One line, for the editor or a log
+    static String describe(const Snapshot& snapshot);
+
+private:
+   #if PMS_PERFORMANCE_COUNTERS
+    struct alignas(64) ThreadCounters
+    {
+        std::atomic<Thread::ThreadID> owner{ nullptr };
+
+        std::atomic<int64> blocks{ 0 }, missedDeadlines{ 0 };
+        std::atomic<int64> blockTicks{ 0 }, deadlineTicks{ 0 };
+        std::atomic<double> lastMissMs{ 0.0 };
+        std::atomic<float> lastLoad{ 0.0f }, peakLoad{ 0.0f };
+        std::atomic<int> activeVoices{ 0 }, peakActiveVoices{ 0 };
+
+        std::atomic<int64> voiceTicks{ 0 }, voiceSamples{ 0 };
+        std::atomic<float> peakTicksPerVoiceSample{ 0.0f };
+
+        std::atomic<int64> noteOns{ 0 }, noteOnTicks{ 0 }, peakNoteOnTicks{ 0 };
+
+        // Only the owning thread writes, so no fetch_add needed
+        template <typename T>
+        static void add(std::atomic<T>& counter, T amount) noexcept
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        template <typename T>
+        static void raise(std::atomic<T>& peak, T value) noexcept
+        {
+            if (value > peak.load(std::memory_order_relaxed))
+                peak.store(value, std::memory_order_relaxed);
+        }
+    };
+
+    // Where the calling thread's slot was last found, and for which counters. A
+    // worker's entry goes stale when any slot is released; the audio callback's
+    // doesn't, its slot is never handed out
+    struct SlotCache
+    {
+        uint32 instance = 0;
+        uint32 epoch = 0;
+        ThreadCounters* slot = nullptr;
+        bool audioCallback = false;
+    };
+
+    static SlotCache& getSlotCache() noexcept
+    {
+        static thread_local SlotCache cache;
+        return cache;
+    }
+
+    static uint32 getNextInstanceId() noexcept
+    {
+        static std::atomic<uint32> lastId{ 0 };
+        return ++lastId;
+    }
+
+    // nullptr once every slot is taken; that thread just isn't counted
+    ThreadCounters* getThreadCounters() noexcept;
+
+    static constexpr int audioCallbackSlot = 0;
+
+    std::array<ThreadCounters, maxThreads> slots;
+    std::atomic<int> numSlotsUsed{ audioCallbackSlot + 1 };    // high-water mark, so lookups stop early
+    std::atomic<uint32> releaseEpoch{ 0 };
+    const uint32 instanceId = getNextInstanceId();
+   #endif
+};
+
+//===============================================================================
+#if PMS_PERFORMANCE_COUNTERS
+
+inline PerformanceCounters::ThreadCounters* PerformanceCounters::getThreadCounters() noexcept
+{
+    auto& cache = getSlotCache();
+    const uint32 epoch = releaseEpoch.load(std::memory_order_acquire);
+
+    if (cache.instance == instanceId && (cache.audioCallback || cache.epoch == epoch))
+        return cache.slot;
+
+    const auto id = Thread::getCurrentThreadId();
+    const int used = numSlotsUsed.load(std::memory_order_acquire);
+    ThreadCounters* found = nullptr;
+
+    for (int i = audioCallbackSlot + 1; i < used && found == nullptr; ++i)
+        if (slots[(size_t)i].owner.load(std::memory_order_relaxed) == id)
+            found = &slots[(size_t)i];
+
+    // First record from this thread: take the lowest free slot, released ones included
+    for (int i = audioCallbackSlot + 1; i < maxThreads && found == nullptr; ++i)
+    {
+        Thread::ThreadID expected = nullptr;
+
+        if (slots[(size_t)i].owner.compare_exchange_strong(expected, id, std::memory_order_acq_rel))
+        {
+            int highWater = numSlotsUsed.load(std::memory_order_relaxed);
+
+            while (highWater < i + 1 && !numSlotsUsed.compare_exchange_weak(highWater, i + 1, std::memory_order_acq_rel)) {}
+
+            found = &slots[(size_t)i];
+        }
+    }
+
+    if (found != nullptr)
+        cache = { instanceId, epoch, found, false };
+
+    return found;
+}
+
+inline int64 PerformanceCounters::startBlock() noexcept
+{
+    getSlotCache() = { instanceId, 0, &slots[(size_t)audioCallbackSlot], true };
+    return startTimer();
+}
+
+inline void PerformanceCounters::releaseThread(Thread::ThreadID threadId) noexcept
+{
+    if (threadId == nullptr)
+        return;
+
+    for (int i = audioCallbackSlot + 1; i < maxThreads; ++i)
+    {
+        auto expected = threadId;
+        slots[(size_t)i].owner.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+    }
+
+    // Cached lookups are checked again against the owners
+    releaseEpoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+inline void PerformanceCounters::recordBlock(int64 startTicks, int numSamples, double sampleRate, int activeVoices) noexcept
+{
+    const int64 ticks = Time::getHighResolutionTicks() - startTicks;
+    auto* c = getThreadCounters();
+
+    if (c == nullptr || numSamples <= 0 || sampleRate <= 0.0)
+        return;
+
+    const auto deadline = (int64)((double)numSamples / sampleRate * (double)Time::getHighResolutionTicksPerSecond());
+    const float load = (float)ticks / (float)jmax((int64)1, deadline);
+
+    ThreadCounters::add(c->blocks, (int64)1);
+    ThreadCounters::add(c->blockTicks, ticks);
+    ThreadCounters::add(c->deadlineTicks, deadline);
+
+    c->lastLoad.store(load, std::memory_order_relaxed);
+    ThreadCounters::raise(c->peakLoad, load);
+
+    c->activeVoices.store(activeVoices, std::memory_order_relaxed);
+    ThreadCounters::raise(c->peakActiveVoices, activeVoices);
+
+    if (ticks > deadline)
+    {
+        ThreadCounters::add(c->missedDeadlines, (int64)1);
+        c->lastMissMs.store(Time::getMillisecondCounterHiRes(), std::memory_order_relaxed);
+    }
+}
+
+inline void PerformanceCounters::recordVoiceRender(int64 startTicks, int numVoices, int numSamples) noexcept
+{
+    const int64 ticks = Time::getHighResolutionTicks() - startTicks;
+    auto* c = getThreadCounters();
+
+    if (c == nullptr)
+        return;
+
+    ThreadCounters::add(c->voiceTicks, ticks);
+
+    if (numVoices > 0 && numSamples > 0)
+    {
+        const int64 voiceSamples = (int64)numVoices * numSamples;
+        ThreadCounters::add(c->voiceSamples, voiceSamples);
+        ThreadCounters::raise(c->peakTicksPerVoiceSample, (float)ticks / (float)voiceSamples);
+    }
+}
+
+inline void PerformanceCounters::recordNoteOn(int64 startTicks) noexcept
+{
+    const int64 ticks = Time::getHighResolutionTicks() - startTicks;
+    auto* c = getThreadCounters();
+
+    if (c == nullptr)
+        return;
+
+    ThreadCounters::add(c->noteOns, (int64)1);
+    ThreadCounters::add(c->noteOnTicks, ticks);
+    ThreadCounters::raise(c->peakNoteOnTicks, ticks);
+}
+
+#else
+
+inline int64 PerformanceCounters::startBlock() noexcept { return 0; }
+inline void PerformanceCounters::recordBlock(int64, int, double, int) noexcept {}
+inline void PerformanceCounters::recordVoiceRender(int64, int, int) noexcept {}
+inline void PerformanceCounters::recordNoteOn(int64) noexcept {}
+inline void PerformanceCounters::releaseThread(Thread::ThreadID) noexcept {}
+
+#endif
@@ -51,11 +51,18 @@ Physical_Model_StringAudioProcessorEditor::Physical_Model_StringAudioProcessorEd
         VisualiserTypeToggle = !VisualiserTypeToggle;
         DBG("Visualiser = " << (VisualiserTypeToggle ? "Waveform" : "Spectrum"));
         VisualiserTypeToggle ? VisualiserSwitchButton.setButtonText("~") : VisualiserSwitchButton.setButtonText("|||");
+        repaint(getVisualiserBounds().getSmallestIntegerContainer());
         };
 
     VisualiserTypeToggle ? VisualiserSwitchButton.setButtonText("~") : VisualiserSwitchButton.setButtonText("|||");
 
-    startTimerHz(60);
+    performanceLabel.setFont(juce::Font(11.0f));
+    performanceLabel.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.7f));
+    performanceLabel.setJustificationType(juce::Justification::bottomLeft);
+    performanceLabel.setInterceptsMouseClicks(false, false);
+    addChildComponent(performanceLabel);
+
+    setTimerRate(activeTimerHz);
 }
 
 Physical_Model_StringAudioProcessorEditor::~Physical_Model_StringAudioProcessorEditor()
@@ -71,6 +78,44 @@ Physical_Model_StringAudioProcessorEditor::~Physical_Model_StringAudioProcessorE
 //==============================================================================
 void Physical_Model_StringAudioProcessorEditor::paint(juce::Graphics& g)
 {
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (chromeImage.isNull() || scale != chromeScale)
+        renderChrome(scale);
+
+    g.drawImageTransformed(chromeImage, juce::AffineTransform::scale(1.0f / chromeScale));
+
+    juce::Rectangle<float> topLeftBox = getVisualiserBounds();
+
+    //Slider and keyboard repaints don't need the visualiser redrawn
+    if (!g.clipRegionIntersects(topLeftBox.getSmallestIntegerContainer()))
+        return;
+
+    if (VisualiserTypeToggle == true) {
+        drawFrame(g, topLeftBox);
+    }
+    else {
+        drawWavePeriod(g, topLeftBox);
+    } 
+}
+
+void Physical_Model_StringAudioProcessorEditor::renderChrome(float scale)
+{
+    chromeScale = scale;
+
+    if (getWidth() <= 0 || getHeight() <= 0)
+    {
+        chromeImage = {};
+        return;
+    }
+
+    chromeImage = juce::Image(juce::Image::ARGB,
+                              juce::roundToInt((float)getWidth() * scale),
+                              juce::roundToInt((float)getHeight() * scale), true);
+
+    juce::Graphics g(chromeImage);
+    g.addTransform(juce::AffineTransform::scale(scale));
+
     // Base gradient background
     juce::ColourGradient gradient(
         juce::Colours::black, 0.0f, 0.0f,
@@ -94,13 +139,7 @@ void Physical_Model_StringAudioProcessorEditor::paint(juce::Graphics& g)
         (float)getWidth(),
         outlinethickness);
 
-    float boxMargin = 2.0f;
-    float boxX = bounds.getX() + boxMargin;
-    float boxY = bounds.getY() + boxMargin;
-    float boxWidth = 300.0f;
-    float boxHeight = originalLineY - boxY; 
-
-    juce::Rectangle<float> topLeftBox(boxX, boxY, boxWidth, boxHeight);
+    juce::Rectangle<float> topLeftBox = getVisualiserBounds();
     g.setColour(juce::Colours::black);
     g.fillRect(topLeftBox);
 
@@ -109,13 +148,20 @@ void Physical_Model_StringAudioProcessorEditor::paint(juce::Graphics& g)
         topLeftBox.getY(),
         outlinethickness,
         topLeftBox.getHeight());
+}
 
-    if (VisualiserTypeToggle == true) {
-        drawFrame(g, topLeftBox);
-    }
-    else {
-        drawWavePeriod(g, topLeftBox);
-    } 
+juce::Rectangle<float> Physical_Model_StringAudioProcessorEditor::getVisualiserBounds() const
+{
+    const float outlinethickness = 3.0f;
+    const float originalLineY = outlinethickness * 53.5f;
+    const float boxMargin = 2.0f;
+
+    juce::Rectangle<float> bounds = getLocalBounds().toFloat().reduced(outlinethickness * 0.5f);
+
+    float boxX = bounds.getX() + boxMargin;
+    float boxY = bounds.getY() + boxMargin;
+
+    return { boxX, boxY, 300.0f, originalLineY - boxY };
 }
 
 void Physical_Model_StringAudioProcessorEditor::resized()
@@ -190,28 +236,85 @@ void Physical_Model_StringAudioProcessorEditor::resized()
 
     //VisualiserToggle
     VisualiserSwitchButton.setBounds(10, 10, 30, 30);
+
+    performanceLabel.setBounds(getVisualiserBounds().reduced(4.0f).removeFromBottom(16.0f).getSmallestIntegerContainer());
+
+    renderChrome(chromeScale);
 }
 
 
+void Physical_Model_StringAudioProcessorEditor::rebuildSpectrumBinMap(int fftOrder, double sampleRate, int numColumns)
+{
+    const int fftSize = 1 << fftOrder;
+    const int lastBin = fftSize / 2;
+    const double binHz = sampleRate / (double)fftSize;
+
+    const double lowHz = 20.0;
+    const double highHz = sampleRate * 0.5;
+
+    auto binForColumnEdge = [&](int edge)
+        {
+            const double hz = lowHz * std::pow(highHz / lowHz, (double)edge / (double)numColumns);
+            return juce::jlimit(0, lastBin, (int)std::round(hz / binHz));
+        };
+
+    spectrumBinMap.resize((size_t)numColumns);
+
+    for (int c = 0; c < numColumns; ++c)
+    {
+        //Low columns are narrower than a bin and just show the nearest one
+        const int start = binForColumnEdge(c);
+        const int end = juce::jmax(start + 1, juce::jmin(lastBin + 1, binForColumnEdge(c + 1)));
+
+        spectrumBinMap[(size_t)c] = { start, end - start };
+    }
+
+    binMapOrder = fftOrder;
+    binMapSampleRate = sampleRate;
+
+    scopeData.assign((size_t)numColumns, 0.0f);
+}
+
 void Physical_Model_StringAudioProcessorEditor::drawNextFrameOfSpectrum()
 {
-    auto fftdata = audioProcessor.fftData.data();
+    //Already windowed, transformed and in dB on the analyser thread
+    auto& analyser = audioProcessor.getSpectrumAnalyser();
+    auto* spectrum = analyser.getSpectrum();
+
+    const int numColumns = juce::jmax(1, (int)getVisualiserBounds().getWidth());
+
+    if (analyser.getSpectrumOrder() != binMapOrder || analyser.getSampleRate() != binMapSampleRate
+        || (int)spectrumBinMap.size() != numColumns)
+        rebuildSpectrumBinMap(analyser.getSpectrumOrder(), analyser.getSampleRate(), numColumns);
+
+    const float mindB = SpectrumAnalyser::minDecibels;
+    const float maxdB = 0.0f;
 
-    audioProcessor.window.multiplyWithWindowingTable(audioProcessor.fftData.data(), audioProcessor.fftSize);
+    const float smoothing = spectrumAveraging == SpectrumAveraging::Long  ? 0.85f
+                          : spectrumAveraging == SpectrumAveraging::Short ? 0.5f
+                                                                          : 0.0f;
 
-    audioProcessor.forwardFFT.performFrequencyOnlyForwardTransform(fftdata);
-    auto mindB = -100.0f;
-    auto maxdB = 0.0f;
-    for (int i = 0; i < audioProcessor.scopeSize; ++i)
+    for (int c = 0; c < numColumns; ++c)
     {
-        auto skewedProportionX = 1.0f - std::exp(std::log(1.0f - (float)i / (float)audioProcessor.scopeSize) * 0.2f);
-        auto fftDataIndex = juce::jlimit(0, audioProcessor.fftSize / 2, (int)(skewedProportionX * (float)audioProcessor.fftSize * 0.5f));
-        auto Level = juce::jmap(juce::jlimit(mindB, maxdB, juce::Decibels::gainToDecibels(fftdata[fftDataIndex]) - juce::Decibels::gainToDecibels((float)audioProcessor.fftSize)),
-            mindB,
-            maxdB,
-            0.0f,
-            1.0f);
-        audioProcessor.scopeData[i] = Level;
+        const auto& bins = spectrumBinMap[(size_t)c];
+        float level;
+
+        if (spectrumColumnMode == SpectrumColumnMode::Peak || bins.count == 1)
+        {
+            level = juce::FloatVectorOperations::findMaximum(spectrum + bins.start, bins.count);
+        }
+        else
+        {
+            float sum = 0.0f;
+
+            for (int i = 0; i < bins.count; ++i)
+                sum += spectrum[bins.start + i];
+
+            level = sum / (float)bins.count;
+        }
+
+        const float target = (juce::jlimit(mindB, maxdB, level) - mindB) / (maxdB - mindB);
+        scopeData[(size_t)c] = target + smoothing * (scopeData[(size_t)c] - target);
     }
 }
 
@@ -223,11 +326,13 @@ void Physical_Model_StringAudioProcessorEditor::drawFrame(juce::Graphics& g, juc
     juce::Path spectrumPath;
     spectrumPath.startNewSubPath(box.getX(), box.getBottom()); // start at bottom-left of the box
 
-    for (int i = 0; i < audioProcessor.scopeSize; ++i)
+    const int numColumns = (int)scopeData.size();
+
+    for (int i = 0; i < numColumns; ++i)
     {
-        float x = juce::jmap((float)i, 0.0f, (float)(audioProcessor.scopeSize - 1),
+        float x = juce::jmap((float)i, 0.0f, (float)juce::jmax(1, numColumns - 1),
             box.getX(), box.getRight());
-        float y = juce::jmap(audioProcessor.scopeData[i], 0.0f, 1.0f,
+        float y = juce::jmap(scopeData[(size_t)i], 0.0f, 1.0f,
             box.getBottom(), box.getY()); // invert y
         spectrumPath.lineTo(x, y);
     }
@@ -247,35 +352,197 @@ void Physical_Model_StringAudioProcessorEditor::drawWavePeriod(juce::Graphics& g
     int width = (int)box.getWidth();
     int height = (int)box.getHeight();
 
-    juce::Path path;
-    path.startNewSubPath(box.getX(), box.getBottom());
+    auto& capture = audioProcessor.getWaveformCapture();
+
+    const juce::int64 writePosition = capture.getWritePosition();
+    const juce::int64 oldest = capture.getOldestReadablePosition();
+
+    //Lock to the held note's period so the waveform stands still; with nothing
+    //held a "period" is 10 ms and the view just scrolls
+    double period = capture.getPeriodInSamples();
+    const bool pitchLocked = period >= 2.0;
+
+    if (!pitchLocked)
+        period = capture.getSampleRate() * 0.01;
 
-    auto& buffer = audioProcessor.waveformBuffer;
-    int writeIndex = audioProcessor.waveformWriteIndex.load();
+    const juce::int64 end = pitchLocked ? capture.findTrigger(writePosition, (int)std::ceil(period) + 1)
+                                        : writePosition;
+    const juce::int64 start = juce::jmax(oldest, end - (juce::int64)std::ceil(scopePeriods * period));
 
-    for (int i = 0; i < audioProcessor.waveformSize; ++i)
+    if (end - start < 2)
+        return;
+
+    auto toY = [&box](float sample)
+        {
+            return juce::jmap(juce::jlimit(-1.0f, 1.0f, sample), -1.0f, 1.0f, box.getBottom(), box.getY());
+        };
+
+    juce::Path path;
+    const int numPixels = juce::jmax(1, (int)box.getWidth());
+
+    if (end - start <= numPixels)
     {
-        int idx = (writeIndex + i) % audioProcessor.waveformSize;
-        float sample = buffer[idx];
+        //Zoomed in past one sample per pixel: draw the samples themselves
+        for (juce::int64 i = start; i < end; ++i)
+        {
+            float x = juce::jmap((float)(i - start), 0.0f, (float)(end - start - 1), box.getX(), box.getRight());
 
-        float x = juce::jmap((float)i, 0.0f, (float)(audioProcessor.waveformSize - 1),
-            box.getX(), box.getRight());
-        float y = juce::jmap(sample, -1.0f, 1.0f,
-            box.getBottom(), box.getY());
-        path.lineTo(x, y);
+            if (i == start)
+                path.startNewSubPath(x, toY(capture.getSample(i)));
+            else
+                path.lineTo(x, toY(capture.getSample(i)));
+        }
+
+        g.setColour(juce::Colours::white.withAlpha(0.6f));
+        g.strokePath(path, juce::PathStrokeType(2.0f));
+        return;
     }
 
+    //Otherwise a min/max envelope per pixel from the capture's pyramid
+    scopeMins.resize((size_t)numPixels);
+    scopeMaxs.resize((size_t)numPixels);
+    capture.getMinMax(start, end, numPixels, scopeMins.data(), scopeMaxs.data());
+
+    path.startNewSubPath(box.getX(), toY(scopeMaxs[0]));
+
+    for (int x = 1; x < numPixels; ++x)
+        path.lineTo(box.getX() + (float)x, toY(scopeMaxs[(size_t)x]));
+
+    for (int x = numPixels; --x >= 0;)
+        path.lineTo(box.getX() + (float)x, toY(scopeMins[(size_t)x]));
+
+    path.closeSubPath();
+
+    g.setColour(juce::Colours::white.withAlpha(0.4f));
+    g.fillPath(path);
+
     g.setColour(juce::Colours::white.withAlpha(0.6f));
-    g.strokePath(path, juce::PathStrokeType(2.0f));
+    g.strokePath(path, juce::PathStrokeType(1.0f));
+}
+
+void Physical_Model_StringAudioProcessorEditor::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    if (!getVisualiserBounds().contains(event.position))
+        return;
+
+    //From one period up to whatever the capture holds (a few seconds)
+    scopePeriods = juce::jlimit(1.0, 1.0e5, scopePeriods * std::pow(2.0, -wheel.deltaY * 4.0));
+    repaint(getVisualiserBounds().getSmallestIntegerContainer());
+}
+
+void Physical_Model_StringAudioProcessorEditor::mouseDown(const juce::MouseEvent& event)
+{
+    if (event.mods.isPopupMenu() && getVisualiserBounds().contains(event.position))
+        showVisualiserMenu();
 }
 
+void Physical_Model_StringAudioProcessorEditor::showVisualiserMenu()
+{
+    auto& analyser = audioProcessor.getSpectrumAnalyser();
+
+    juce::PopupMenu fftSizes;
+
+    for (int order = SpectrumAnalyser::minFftOrder; order <= SpectrumAnalyser::maxFftOrder; ++order)
+        fftSizes.addItem(juce::String(1 << order), true, analyser.getFftOrder() == order,
+                         [&analyser, order] { analyser.setFftOrder(order); });
+
+    juce::PopupMenu columns;
+    columns.addItem("Peak", true, spectrumColumnMode == SpectrumColumnMode::Peak,
+                    [this] { spectrumColumnMode = SpectrumColumnMode::Peak; });
+    columns.addItem("Average", true, spectrumColumnMode == SpectrumColumnMode::Average,
+                    [this] { spectrumColumnMode = SpectrumColumnMode::Average; });
+
+    juce::PopupMenu averaging;
+    averaging.addItem("Off", true, spectrumAveraging == SpectrumAveraging::Off,
+                      [this] { spectrumAveraging = SpectrumAveraging::Off; });
+    averaging.addItem("Short", true, spectrumAveraging == SpectrumAveraging::Short,
+                      [this] { spectrumAveraging = SpectrumAveraging::Short; });
+    averaging.addItem("Long", true, spectrumAveraging == SpectrumAveraging::Long,
+                      [this] { spectrumAveraging = SpectrumAveraging::Long; });
+
+    juce::PopupMenu menu;
+    menu.addSubMenu("FFT size", fftSizes);
+    menu.addSubMenu("Bands", columns);
+    menu.addSubMenu("Averaging", averaging);
+    menu.addSeparator();
+    menu.addItem("Performance", true, performanceLabel.isVisible(),
+                 [this] { performanceLabel.setVisible(!performanceLabel.isVisible()); updatePerformanceLabel(); });
+    menu.addItem("Reset performance peaks", performanceLabel.isVisible(), false,
+                 [this] { audioProcessor.getPerformanceCounters().resetPeaks(); updatePerformanceLabel(); });
+
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this));
+}
+
+
+void Physical_Model_StringAudioProcessorEditor::setTimerRate(int hz)
+{
+    if (hz != timerHz)
+    {
+        timerHz = hz;
+        startTimerHz(hz);
+    }
+}
+
+void Physical_Model_StringAudioProcessorEditor::updatePerformanceLabel()
+{
+    performanceTicks = 0;
+
+    if (!PerformanceCounters::enabled)
+    {
+        performanceLabel.setText("Performance counters compiled out", juce::dontSendNotification);
+        return;
+    }
+
+    const auto s = audioProcessor.getPerformanceCounters().getSnapshot();
+
+    performanceLabel.setText("CPU " + juce::String(juce::roundToInt(s.lastLoad * 100.0f)) + "% (peak "
+                             + juce::String(juce::roundToInt(s.peakLoad * 100.0f)) + "%)  late "
+                             + juce::String(s.missedDeadlines) + "  voices " + juce::String(s.activeVoices)
+                             + "  note-on " + juce::String(s.peakNoteOnNs / 1000.0, 1) + " us",
+                             juce::dontSendNotification);
+}
+
+bool Physical_Model_StringAudioProcessorEditor::isOutputSilent() const
+{
+    auto& capture = audioProcessor.getWaveformCapture();
+
+    //Last ~50 ms below -90 dBFS
+    return capture.getRecentPeak((int)(capture.getSampleRate() * 0.05)) < 3.0e-5f;
+}
 
 void Physical_Model_StringAudioProcessorEditor::timerCallback()
 {
-    if (audioProcessor.nextFFTBlockReady)
+    //Hidden (minimised, behind a tab...): just poll now and then for coming back
+    if (!isShowing())
+    {
+        setTimerRate(idleTimerHz);
+        return;
+    }
+
+    if (performanceLabel.isVisible() && ++performanceTicks >= performanceRefreshTicks * timerHz / activeTimerHz)
+        updatePerformanceLabel();
+
+    //Keep drawing a little after the sound stops so the displays settle, then idle
+    silentTicks = isOutputSilent() ? silentTicks + 1 : 0;
+    setTimerRate(silentTicks > silentTicksBeforeIdle ? idleTimerHz : activeTimerHz);
+
+    const auto visualiserArea = getVisualiserBounds().getSmallestIntegerContainer();
+
+    //Only the newest complete frame is read, older ones are skipped
+    if (audioProcessor.getSpectrumAnalyser().updateLatestSpectrum())
     {
         drawNextFrameOfSpectrum();
-        audioProcessor.nextFFTBlockReady = false;
-        repaint();
+
+        if (VisualiserTypeToggle)
+            repaint(visualiserArea);
+    }
+
+    //Waveform view only needs redrawing once new audio has been captured
+    const auto waveformPosition = audioProcessor.getWaveformCapture().getWritePosition();
+
+    if (!VisualiserTypeToggle && waveformPosition != lastWaveformPosition)
+    {
+        lastWaveformPosition = waveformPosition;
+        repaint(visualiserArea);
     }
 }
\ No newline at end of file
@@ -16,6 +16,9 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
 
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+
     void timerCallback() override;
     void drawNextFrameOfSpectrum();
     void drawFrame(juce::Graphics& g, juce::Rectangle<float> box);
@@ -36,6 +39,59 @@ private:
 
     bool VisualiserTypeToggle = false;
 
+    //Spectrum: one display column per pixel, each the max or average of the FFT
+    //bins it covers on a log frequency axis. The bin ranges only change with the
+    //FFT size, sample rate or width, so they're worked out once and kept
+    enum class SpectrumColumnMode { Peak, Average };
+    enum class SpectrumAveraging { Off, Short, Long };
+
+    struct BinRange { int start = 0, count = 1; };
+
+    void rebuildSpectrumBinMap(int fftOrder, double sampleRate, int numColumns);
+    void showVisualiserMenu();
+
+    std::vector<BinRange> spectrumBinMap;
+    int binMapOrder = 0;
+    double binMapSampleRate = 0.0;
+
+    std::vector<float> scopeData;
+    SpectrumColumnMode spectrumColumnMode = SpectrumColumnMode::Peak;
+    SpectrumAveraging spectrumAveraging = SpectrumAveraging::Short;
+
+    //Waveform zoom in string periods (mouse wheel), and per-pixel min/max scratch
+    double scopePeriods = 2.0;
+    std::vector<float> scopeMins, scopeMaxs;
+    juce::int64 lastWaveformPosition = -1;
+
+    juce::Rectangle<float> getVisualiserBounds() const;
+
+    //Background, outline, divider and visualiser box never change between
+    //frames, so they're drawn once into an image (at the display's pixel scale)
+    void renderChrome(float scale);
+
+    juce::Image chromeImage;
+    float chromeScale = 1.0f;
+
+    //Timer runs at full rate only while the editor is showing and there's sound
+    static constexpr int activeTimerHz = 60;
+    static constexpr int idleTimerHz = 5;
+    static constexpr int silentTicksBeforeIdle = 30;
+
+    void setTimerRate(int hz);
+    bool isOutputSilent() const;
+
+    int timerHz = 0;
+    int silentTicks = 0;
+
+    //Audio thread load, late blocks, voices and note-on cost, over the visualiser.
+    //Toggled from the visualiser menu and refreshed a few times a second
+    static constexpr int performanceRefreshTicks = 15;
+
+    void updatePerformanceLabel();
+
+    Label performanceLabel;
+    int performanceTicks = 0;
+
     Physical_Model_StringAudioProcessor& audioProcessor;
 
     MidiKeyboardComponent midikeyboard;
@@ -7,7 +7,10 @@
 */
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
+
+#if ! PMS_HEADLESS
+ #include "PluginEditor.h"
+#endif
 
 //==============================================================================
 Physical_Model_StringAudioProcessor::Physical_Model_StringAudioProcessor()
@@ -19,23 +22,82 @@ Physical_Model_StringAudioProcessor::Physical_Model_StringAudioProcessor()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       ), myVoice(nullptr), lastSampleRate(getSampleRate()),
-                          forwardFFT(fftOrder),
-                          window(fftSize, juce::dsp::WindowingFunction<float>::hamming)
+                       ), myVoice(nullptr), lastSampleRate(getSampleRate())
 #endif
 {
-    mySynth.clearVoices();
+    params.attack = getParameterHandle("Attack");
+    params.decay = getParameterHandle("Decay");
+    params.sustain = getParameterHandle("Sustain");
+    params.release = getParameterHandle("Release");
+    params.bridgeRefCoeff = getParameterHandle("BRC");
+    params.pluckPos = getParameterHandle("PluckPos");
+    params.excitation = getParameterHandle("Excitation");
+    params.lossFilter = getParameterHandle("LossFilter");
+    params.lossCutoff = getParameterHandle("LossCutoff");
+    params.retireThreshold = getParameterHandle("RetireThreshold");
+    params.quality = getParameterHandle("Quality");
+    params.voiceModel = getParameterHandle("VoiceModel");
+    params.inharmonicity = getParameterHandle("Inharmonicity");
+    params.bridgeCoupling = getParameterHandle("BridgeCoupling");
+    params.pitchBendRange = getParameterHandle("PitchBendRange");
+    params.vibratoDepth = getParameterHandle("VibratoDepth");
+    params.vibratoRate = getParameterHandle("VibratoRate");
+    params.bodyMix = getParameterHandle("BodyMix");
+    params.costBudget = getParameterHandle("CostBudget");
+
+    presetValues.resize((size_t)getParameters().size());
+
+    publishParameterSnapshot();
 
-    for (int i = 0; i < 12; i++) {
-        mySynth.addVoice(new SynthVoice(this));
-    }
+    mySynth.clearVoices();
+    mySynth.setVoiceFactory([this] { return new SynthVoice(this); });
 
     mySynth.clearSounds();
     mySynth.addSound(new SynthSound());
+
+    for (auto* id : engineParameterIDs)
+        apvts.addParameterListener(id, this);
+
+    //Voices, threads and budget from the parameter defaults
+    applyEngineSettings();
 }
 
 Physical_Model_StringAudioProcessor::~Physical_Model_StringAudioProcessor()
 {
+    for (auto* id : engineParameterIDs)
+        apvts.removeParameterListener(id, this);
+
+    cancelPendingUpdate();
+}
+
+//==============================================================================
+void Physical_Model_StringAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    juce::ignoreUnused(parameterID, newValue);
+    triggerAsyncUpdate();
+}
+
+void Physical_Model_StringAudioProcessor::handleAsyncUpdate()
+{
+    //A program the audio thread already plays: set the parameters from it (which
+    //tells the host and the editor), then let the snapshot read them again. A
+    //newer program arriving meanwhile keeps the overlay for the next update
+    int program = presetOverlay.load();
+
+    if (program >= 0)
+    {
+        presetBank.publishPreset(program);
+        presetOverlay.compare_exchange_strong(program, -1);
+    }
+
+    applyEngineSettings();
+}
+
+void Physical_Model_StringAudioProcessor::applyEngineSettings()
+{
+    mySynth.setPolyphony((int)apvts.getRawParameterValue("Polyphony")->load());
+    mySynth.setCostBudget(apvts.getRawParameterValue("CostBudget")->load());
+    mySynth.setNumRenderThreads((int)apvts.getRawParameterValue("RenderThreads")->load());
 }
 
 //==============================================================================
@@ -73,27 +135,34 @@ bool Physical_Model_StringAudioProcessor::isMidiEffect() const
 
 double Physical_Model_StringAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    if (bodyImpulseRate <= 0.0)
+        return 0.0;
+
+    return juce::jmin(BodyResonator::maxImpulseSeconds, bodyImpulse.getNumSamples() / bodyImpulseRate);
 }
 
 int Physical_Model_StringAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    // NB: some hosts don't cope very well if you tell them there are 0 programs,
+    // so this should be at least 1, even with no preset bank loaded.
+    return juce::jmax(1, presetBank.getNumPresets());
 }
 
 int Physical_Model_StringAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    const int pending = pendingProgram.load();
+    return pending >= 0 ? pending : currentProgram.load();
 }
 
 void Physical_Model_StringAudioProcessor::setCurrentProgram (int index)
 {
+    //Applied by the audio thread at the start of its next block
+    pendingProgram.store(index);
 }
 
 const juce::String Physical_Model_StringAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presetBank.getPresetName(index);
 }
 
 void Physical_Model_StringAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -103,15 +172,23 @@ void Physical_Model_StringAudioProcessor::changeProgramName (int index, const ju
 //==============================================================================
 void Physical_Model_StringAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    ignoreUnused(samplesPerBlock); //Ignores Samples from last key pressed
     lastSampleRate = sampleRate;
-    mySynth.setCurrentPlaybackSampleRate(lastSampleRate);
+    maxBlockSize = samplesPerBlock;
 
-    for (int i = 0; i < mySynth.getNumVoices(); i++)
-    {
-        if (auto* voice = static_cast<SynthVoice*>(mySynth.getVoice(i)))
-            voice->prepareToPlay(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
-    }
+    publishParameterSnapshot();
+
+    //Arena, voices and the lockstep string bank
+    mySynth.prepare(lastSampleRate, samplesPerBlock, getTotalNumOutputChannels(), isUsingDoublePrecision());
+
+    if (isUsingDoublePrecision())
+        precisionScratch.setSize(1, juce::jmax(1, samplesPerBlock));
+    else
+        precisionScratch.setSize(0, 0);
+
+    spectrumAnalyser.prepare(lastSampleRate);
+    waveformCapture.prepare(lastSampleRate);
+
+    rebuildBodyResonator();
 }
 
 void Physical_Model_StringAudioProcessor::releaseResources()
@@ -123,12 +200,9 @@ void Physical_Model_StringAudioProcessor::releaseResources()
             voice->releaseResources();
     }
 
-    // Clear FIFO and FFT data buffers
-    std::fill(fifo.begin(), fifo.end(), 0.0f);
-    fifoIndex = 0;
+    mySynth.releaseResources();
 
-    std::fill(fftData.begin(), fftData.end(), 0.0f);
-    nextFFTBlockReady = false;
+    spectrumAnalyser.release();
 
     numSamples = 0;
 }
@@ -155,26 +229,36 @@ bool Physical_Model_StringAudioProcessor::isBusesLayoutSupported (const BusesLay
 }
 #endif
 
-void Physical_Model_StringAudioProcessor::pushNextSampleIntoFifo(float sample)
+void Physical_Model_StringAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    if (fifoIndex == fftSize)
-    {
-        if (!nextFFTBlockReady)
-        {
-            std::fill(fftData.begin(), fftData.end(), 0.0f);
-            std::copy(fifo.begin(), fifo.end(), fftData.begin());
-            nextFFTBlockReady = true;
-        }
-        fifoIndex = 0;
-    }
-    fifo[(size_t)fifoIndex++] = sample;
+    renderBlock(buffer, midiMessages);
 }
 
-void Physical_Model_StringAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+void Physical_Model_StringAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
 {
+    renderBlock(buffer, midiMessages);
+}
+
+template <typename SampleType>
+void Physical_Model_StringAudioProcessor::renderBlock(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
+{
+    const auto blockStart = getPerformanceCounters().startBlock();
+
     buffer.clear();
 
-    getChainSettings(processorChainsettings);
+    //Program change: the last one in the block wins, applied before anything renders
+    for (const auto metadata : midiMessages)
+    {
+        const auto message = metadata.getMessage();
+
+        if (message.isProgramChange())
+            pendingProgram.store(message.getProgramChangeNumber());
+    }
+
+    applyPendingProgram();
+
+    publishParameterSnapshot();
+    mySynth.setBridgeCoupling(processorChainsettings.BridgeCoupling);
 
     numSamples = buffer.getNumSamples();
 
@@ -182,68 +266,231 @@ void Physical_Model_StringAudioProcessor::processBlock(juce::AudioBuffer<float>&
 
     mySynth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
 
-    auto* channelData = buffer.getReadPointer(0);
+    applyBody(buffer, numSamples);
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    if constexpr (std::is_same_v<SampleType, float>)
+    {
+        pushToDisplays(buffer.getReadPointer(0), numSamples);
+    }
+    else
     {
-        float sample = channelData[i];
-        float fullrangesample = juce::jlimit(-1.0f, 1.0f, sample);
+        //The output stays double; the displays get channel 0 narrowed a scratch
+        //block at a time
+        for (int start = 0; precisionScratch.getNumSamples() > 0 && start < numSamples; start += precisionScratch.getNumSamples())
+        {
+            const int chunk = juce::jmin(numSamples - start, precisionScratch.getNumSamples());
+            const double* output = buffer.getReadPointer(0, start);
+            float* narrowed = precisionScratch.getWritePointer(0);
 
-        int index = waveformWriteIndex.fetch_add(1);
-        waveformBuffer[(size_t)(index % waveformSize)] = fullrangesample;
+            for (int n = 0; n < chunk; n++)
+                narrowed[n] = (float)output[n];
 
-        pushNextSampleIntoFifo(sample);
+            pushToDisplays(narrowed, chunk);
+        }
     }
 
-    for (int channel = 0; channel < buffer.getNumChannels(); channel++)
-    {
-        auto* writePtr = buffer.getWritePointer(channel);
+    if constexpr (PerformanceCounters::enabled)
+        getPerformanceCounters().recordBlock(blockStart, numSamples, lastSampleRate, mySynth.getNumActiveVoices());
+}
 
-        for (int sample = 0; sample < numSamples; sample++)
-        {
-            float Data = writePtr[sample];
-     
+template <typename SampleType>
+void Physical_Model_StringAudioProcessor::applyBody(juce::AudioBuffer<SampleType>& buffer, int numSamples) noexcept
+{
+    //Body: one convolution of the summed voices, zero latency
+    const juce::SpinLock::ScopedTryLockType bodyTryLock(bodyLock);
 
+    if (bodyTryLock.isLocked() && bodyResonator != nullptr)
+        bodyResonator->process(buffer, numSamples, loadParameter(params.bodyMix));
+}
 
-            writePtr[sample] = Data;
-        }
+void Physical_Model_StringAudioProcessor::pushToDisplays(const float* channelData, int numSamples) noexcept
+{
+    //Spectrum: one copy into the analyser's FIFO, the FFT runs on its own thread
+    spectrumAnalyser.pushSamples(channelData, numSamples);
+
+    //Scope: one ring write and one atomic publish for the whole block
+    waveformCapture.pushBlock(channelData, numSamples, mySynth.getNewestPeriodInSamples());
+}
+
+//==============================================================================
+bool Physical_Model_StringAudioProcessor::loadBodyImpulseResponse(const juce::File& file)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr)
+        return false;
+
+    const int length = (int)juce::jmin(reader->lengthInSamples,
+                                       (juce::int64)(BodyResonator::maxImpulseSeconds * reader->sampleRate));
+
+    juce::AudioBuffer<float> impulseResponse(juce::jmin(2, (int)reader->numChannels), length);
+    reader->read(&impulseResponse, 0, length, 0, true, impulseResponse.getNumChannels() > 1);
+
+    setBodyImpulseResponse(impulseResponse, reader->sampleRate);
+    apvts.state.setProperty("BodyImpulse", file.getFullPathName(), nullptr);
+    return true;
+}
+
+void Physical_Model_StringAudioProcessor::setBodyImpulseResponse(const juce::AudioBuffer<float>& impulseResponse, double impulseSampleRate)
+{
+    bodyImpulse.makeCopyOf(impulseResponse);
+    bodyImpulseRate = impulseSampleRate;
+    apvts.state.removeProperty("BodyImpulse", nullptr);
+
+    rebuildBodyResonator();
+}
+
+void Physical_Model_StringAudioProcessor::clearBodyImpulseResponse()
+{
+    setBodyImpulseResponse({}, 0.0);
+}
+
+void Physical_Model_StringAudioProcessor::rebuildBodyResonator()
+{
+    std::unique_ptr<BodyResonator> resonator;
+
+    if (lastSampleRate > 0.0 && bodyImpulse.getNumSamples() > 0)
+    {
+        resonator = std::make_unique<BodyResonator>();
+
+        if (!resonator->prepare(bodyImpulse, bodyImpulseRate, lastSampleRate, juce::jmax(1, maxBlockSize)))
+            resonator.reset();
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock(bodyLock);
+        std::swap(bodyResonator, resonator);
     }
 
+    //The old one is freed here, outside the lock
 }
 
 //==============================================================================
 bool Physical_Model_StringAudioProcessor::hasEditor() const
 {
-    return true;
+    return ! PMS_HEADLESS;
 }
 
 juce::AudioProcessorEditor* Physical_Model_StringAudioProcessor::createEditor()
 {
+   #if PMS_HEADLESS
+    return nullptr;
+   #else
     return new Physical_Model_StringAudioProcessorEditor (*this);
+   #endif
 }
 
 //==============================================================================
 void Physical_Model_StringAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
+    //Parameters (engine settings included), body IR and preset bank paths, program
+    auto state = apvts.copyState();
+    state.setProperty("Program", getCurrentProgram(), nullptr);
 
+    PresetBank::encodeState(state, destData);
 }
 
 void Physical_Model_StringAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    auto state = PresetBank::decodeState(data, sizeInBytes);
+
+    if (!state.hasType(apvts.state.getType()))
+        return;
+
+    //Engine parameters that changed reach the synth through the async update
+    apvts.replaceState(state);
+
+    currentProgram.store((int)state.getProperty("Program", 0));
+    pendingProgram.store(-1);
+    presetOverlay.store(-1);
+
+    const juce::File bodyFile(state.getProperty("BodyImpulse").toString());
+
+    if (bodyFile.existsAsFile())
+        loadBodyImpulseResponse(bodyFile);
+    else
+        clearBodyImpulseResponse();
+
+    const juce::File bankFolder(state.getProperty("PresetBank").toString());
+
+    if (bankFolder.isDirectory())
+        presetBank.loadFolder(bankFolder);
+}
+
+void Physical_Model_StringAudioProcessor::loadPresetBank(const juce::File& folder)
+{
+    presetBank.loadFolder(folder);
+    apvts.state.setProperty("PresetBank", folder.getFullPathName(), nullptr);
+}
+
+void Physical_Model_StringAudioProcessor::applyPendingProgram() noexcept
+{
+    int program = pendingProgram.load();
+
+    if (program < 0)
+        return;
+
+    //Busy: the bank is mid-swap, leave it pending for the next block
+    const auto result = presetBank.readPreset(program, presetValues.data());
+
+    if (result == PresetBank::ReadResult::busy)
+        return;
+
+    if (result == PresetBank::ReadResult::copied)
+    {
+        //Everything a block boundary can take without allocating switches here:
+        //the snapshot (published next), body mix and cost budget. Polyphony and
+        //render threads follow on the message thread
+        presetOverlay.store(program);
+        mySynth.setCostBudget(loadParameter(params.costBudget));
+
+        currentProgram.store(program);
+        triggerAsyncUpdate();
+    }
 
+    //Unless another change arrived in the meantime
+    pendingProgram.compare_exchange_strong(program, -1);
 }
 
 //==============================================================================
+Physical_Model_StringAudioProcessor::ParameterHandle
+Physical_Model_StringAudioProcessor::getParameterHandle(const char* parameterID)
+{
+    return { apvts.getRawParameterValue(parameterID), apvts.getParameter(parameterID)->getParameterIndex() };
+}
+
+float Physical_Model_StringAudioProcessor::loadParameter(const ParameterHandle& handle) const noexcept
+{
+    if (presetOverlay.load() >= 0)
+        return presetValues[(size_t)handle.index];
+
+    return handle.value->load(std::memory_order_relaxed);
+}
+
 void Physical_Model_StringAudioProcessor::getChainSettings(ChainSettings& settings)
 {
     //ADSR (
-    settings.Attack = apvts.getRawParameterValue("Attack")->load();
-    settings.Decay = apvts.getRawParameterValue("Decay")->load();
-    settings.Sustain = apvts.getRawParameterValue("Sustain")->load();
-    settings.Release = apvts.getRawParameterValue("Release")->load();
-
-    settings.BridgeRefCoeff = apvts.getRawParameterValue("BRC")->load();
-    settings.PluckPos = apvts.getRawParameterValue("PluckPos")->load();
+    settings.Attack = loadParameter(params.attack);
+    settings.Decay = loadParameter(params.decay);
+    settings.Sustain = loadParameter(params.sustain);
+    settings.Release = loadParameter(params.release);
+
+    settings.BridgeRefCoeff = loadParameter(params.bridgeRefCoeff);
+    settings.PluckPos = loadParameter(params.pluckPos);
+    settings.LossType = static_cast<LossFilterType>((int)loadParameter(params.lossFilter));
+    settings.Excitation = static_cast<ExcitationType>((int)loadParameter(params.excitation));
+    settings.LossCutoff = loadParameter(params.lossCutoff);
+    settings.RetireThresholdDb = loadParameter(params.retireThreshold);
+    settings.AdaptiveQuality = loadParameter(params.quality) > 0.5f;
+    settings.Model = static_cast<VoiceModel>((int)loadParameter(params.voiceModel));
+    settings.Inharmonicity = loadParameter(params.inharmonicity);
+    settings.BridgeCoupling = loadParameter(params.bridgeCoupling);
+    settings.PitchBendRange = loadParameter(params.pitchBendRange);
+    settings.VibratoDepth = loadParameter(params.vibratoDepth);
+    settings.VibratoRate = loadParameter(params.vibratoRate);
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout
@@ -281,6 +528,93 @@ Physical_Model_StringAudioProcessor::createParameterLayout()
         juce::NormalisableRange<float>(0.2f, 1.0f, 0.01f),
         0.5f));
 
+    //Initial string shape; Strike centres on PluckPos, Noise ignores it
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "Excitation", "Excitation",
+        juce::StringArray{ "Pluck", "Strike", "Noise" },
+        0));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "LossFilter", "LossFilter",
+        juce::StringArray{ "Moving Average", "One Pole", "BiQuad", "Allpass Dispersion" },
+        2));
+
+    //Loss filter corner, follows automation on ringing strings
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "LossCutoff", "LossCutoff",
+        juce::NormalisableRange<float>(1000.0f, 20000.0f, 1.0f, 0.3f),
+        LossFilter<float>::defaultCutoff));
+
+    //Adaptive: fractional tuning on every string, and 2x/4x internal rate for short ones
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "Quality", "Quality",
+        juce::StringArray{ "Standard", "Adaptive" },
+        0));
+
+    //Semitones at full pitch wheel. Two octaves at most: past one octave up the
+    //string starts shorter to leave room, which thins the pluck the further it goes
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "PitchBendRange", "PitchBendRange",
+        juce::NormalisableRange<float>(0.0f, 24.0f, 1.0f),
+        2.0f));
+
+    //Vibrato depth (semitones) at full mod wheel, and its rate
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "VibratoDepth", "VibratoDepth",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        0.3f));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "VibratoRate", "VibratoRate",
+        juce::NormalisableRange<float>(0.5f, 12.0f, 0.1f),
+        5.5f));
+
+    //Waveguide string, or a bank of damped modes for stiff/inharmonic sounds
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "VoiceModel", "VoiceModel",
+        juce::StringArray{ "Waveguide", "Modal" },
+        0));
+
+    //Stiffness of the modal voice and of strings with the Allpass Dispersion
+    //loss filter, partials at k f0 sqrt(1 + B k^2)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "Inharmonicity", "Inharmonicity",
+        juce::NormalisableRange<float>(0.0f, 0.05f, 0.0001f, 0.3f),
+        0.001f));
+
+    //Sympathetic coupling: admittance of the bridge all strings share, 0 = rigid
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "BridgeCoupling", "BridgeCoupling",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.001f, 0.4f),
+        0.0f));
+
+    //Dry/wet of the body IR (no effect until one is loaded)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "BodyMix", "BodyMix",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        1.0f));
+
+    //String level (dBFS) below which a voice is freed even if its key is held
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "RetireThreshold", "RetireThreshold",
+        juce::NormalisableRange<float>(-160.0f, -60.0f, 1.0f),
+        -110.0f));
+
+    //Extra threads for rendering voices, 0 keeps everything on the host's audio thread
+    layout.add(std::make_unique<juce::AudioParameterInt>(
+        "RenderThreads", "RenderThreads",
+        0, 8, 0));
+
+    layout.add(std::make_unique<juce::AudioParameterInt>(
+        "Polyphony", "Polyphony",
+        StringSynthesiser::minPolyphony, StringSynthesiser::maxPolyphony, 12));
+
+    //Sum of voice render costs a new note may not exceed, 0 = no budget
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "CostBudget", "CostBudget",
+        juce::NormalisableRange<float>(0.0f, 512.0f, 1.0f),
+        0.0f));
+
     return layout;
 }
 
@@ -3,10 +3,23 @@
 #include <JuceHeader.h>
 #include "SynthSound.h"
 #include "SynthVoice.h"
+#include "StringSynthesiser.h"
+#include "SpectrumAnalyser.h"
+#include "WaveformCapture.h"
+#include "BodyResonator.h"
+#include "PresetBank.h"
 #include <stk_wrapper/stk_wrapper.h>
 
+//Set to 1 by the console tools, which build the processor without the editor
+//or its look and feel; hasEditor() is then false
+#ifndef PMS_HEADLESS
+ #define PMS_HEADLESS 0
+#endif
+
 //==============================================================================
-class Physical_Model_StringAudioProcessor  : public juce::AudioProcessor
+class Physical_Model_StringAudioProcessor  : public juce::AudioProcessor,
+                                             private juce::AudioProcessorValueTreeState::Listener,
+                                             private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -23,6 +36,11 @@ public:
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+    //Double hosts get double strings end to end through the voice mix; the body
+    //convolution and the displays stay float
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -48,6 +66,27 @@ public:
 
     void getChainSettings(ChainSettings& settings);
 
+    //Reads every parameter once into the snapshot voices use for this block.
+    //Audio thread (or before rendering starts)
+    void publishParameterSnapshot() { getChainSettings(processorChainsettings); }
+    const ChainSettings& getParameterSnapshot() const noexcept { return processorChainsettings; }
+
+    //Pushes polyphony/threads/budget from the parameters into the synth. Message
+    //thread (or any thread with no audio callback running, e.g. offline renders)
+    void applyEngineSettings();
+
+    //Body IR for the commuted synthesis stage. Message thread: the file is decoded
+    //and the convolution built here, then swapped in between audio blocks
+    bool loadBodyImpulseResponse(const juce::File& file);
+    void setBodyImpulseResponse(const juce::AudioBuffer<float>& impulseResponse, double impulseSampleRate);
+    void clearBodyImpulseResponse();
+    juce::String getBodyImpulseName() const { return apvts.state.getProperty("BodyImpulse").toString(); }
+
+    //Presets for host program changes and MIDI program change. Message thread;
+    //the folder is decoded in the background and kept in the saved state
+    void loadPresetBank(const juce::File& folder);
+    void waitForPresetBank() { presetBank.waitForLoad(); }
+
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
     juce::AudioProcessorValueTreeState apvts{
@@ -58,45 +97,115 @@ public:
     //==============================================================================
     juce::MidiKeyboardState& getMidiKeyboardState() { return midiKeyboardState; }
 
+    //Block, voice and note-on timing from the audio and render threads. Reading a
+    //snapshot never blocks them, from the editor or a headless dump
+    PerformanceCounters& getPerformanceCounters() noexcept { return mySynth.getPerformanceCounters(); }
+
 private:
+    //Engine config changes are applied on the message thread, outside the audio callback
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+
+    //Builds a BodyResonator for the current IR and rate and swaps it in (or out)
+    void rebuildBodyResonator();
+
+    //Audio thread, at the top of the block before the snapshot is published, so a
+    //new preset's parameters all land in the same block. Never touches the
+    //parameters themselves
+    void applyPendingProgram() noexcept;
+
+    //Both processBlock overloads
+    template <typename SampleType>
+    void renderBlock(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages);
+
+    //Body on the voice sum in channel 0, at the host's precision
+    template <typename SampleType>
+    void applyBody(juce::AudioBuffer<SampleType>& buffer, int numSamples) noexcept;
+
+    //Spectrum and scope, which only ever see float
+    void pushToDisplays(const float* channelData, int numSamples) noexcept;
+
+    static constexpr const char* engineParameterIDs[] = { "RenderThreads", "Polyphony", "CostBudget" };
+
+    //Parameter values resolved by ID once at construction, not per lookup
+    struct ParameterHandle
+    {
+        std::atomic<float>* value = nullptr;
+        int index = -1;
+    };
 
-    Synthesiser mySynth;
+    struct ParameterHandles
+    {
+        ParameterHandle attack;
+        ParameterHandle decay;
+        ParameterHandle sustain;
+        ParameterHandle release;
+        ParameterHandle bridgeRefCoeff;
+        ParameterHandle pluckPos;
+        ParameterHandle excitation;
+        ParameterHandle lossFilter;
+        ParameterHandle lossCutoff;
+        ParameterHandle retireThreshold;
+        ParameterHandle quality;
+        ParameterHandle voiceModel;
+        ParameterHandle inharmonicity;
+        ParameterHandle bridgeCoupling;
+        ParameterHandle pitchBendRange;
+        ParameterHandle vibratoDepth;
+        ParameterHandle vibratoRate;
+        ParameterHandle bodyMix;
+        ParameterHandle costBudget;
+    };
+
+    ParameterHandle getParameterHandle(const char* parameterID);
+
+    //The preset's value while a program change is still being published, the
+    //parameter's own otherwise
+    float loadParameter(const ParameterHandle& handle) const noexcept;
+
+    ParameterHandles params;
+
+    StringSynthesiser mySynth;
     SynthVoice* myVoice;
 
     juce::MidiKeyboardState midiKeyboardState;
 
-    ChainSettings processorChainsettings;
-
-    double lastSampleRate;
+    SpectrumAnalyser spectrumAnalyser;
+    WaveformCapture waveformCapture;
 
-    float mix = 0.0f, pan = 0.50;
+    //Applied once to the voice sum; the audio thread only try-locks, so a swap in
+    //progress costs it one dry block rather than a wait
+    std::unique_ptr<BodyResonator> bodyResonator;
+    juce::SpinLock bodyLock;
+    juce::AudioBuffer<float> bodyImpulse;
+    double bodyImpulseRate = 0.0;
+    int maxBlockSize = 0;
 
-  public:
+    //Float copy of a double block for the body and displays; empty in float mode
+    juce::AudioBuffer<float> precisionScratch;
 
-    static constexpr auto fftOrder = 11;
-    static constexpr auto fftSize = 1 << fftOrder;
+    //Program changes (host or MIDI) wait here for the next block boundary
+    PresetBank presetBank{ apvts };
+    std::atomic<int> pendingProgram{ -1 };
+    std::atomic<int> currentProgram{ 0 };
 
-    void pushNextSampleIntoFifo(float sample);
-    bool getNextFFTBlockReady() const { return nextFFTBlockReady; }
-    void setNextFFTBlockReady(bool ready) { nextFFTBlockReady = ready; }
-    const float* getFFTData() const { return fftData.data(); }
+    //A program change reaches the snapshot in the block it's applied, from these
+    //plain values (audio thread only, by parameter index). The parameters and the
+    //host hear of it later from the message thread, which then hands the snapshot
+    //back to them; until it does, presetOverlay holds the program
+    std::vector<float> presetValues;
+    std::atomic<int> presetOverlay{ -1 };
 
-    int scopeSize = 1024;
-    float scopeData[1024];
+    ChainSettings processorChainsettings;
 
-    juce::dsp::WindowingFunction<float> window;
+    double lastSampleRate;
 
-    juce::dsp::FFT forwardFFT;
-    std::array<float, fftSize> fifo;
-    std::array<float, fftSize * 2> fftData;
-    int fifoIndex = 0;
-    bool nextFFTBlockReady = false;
+    float mix = 0.0f, pan = 0.50;
 
-    static constexpr int waveformSize = 512;
-    std::array<float, waveformSize> waveformBuffer{};
-    std::atomic<int> waveformWriteIndex{ 0 };
+  public:
 
-    juce::AudioBuffer<float> timeDomainBuffer;
+    SpectrumAnalyser& getSpectrumAnalyser() noexcept { return spectrumAnalyser; }
+    const WaveformCapture& getWaveformCapture() const noexcept { return waveformCapture; }
 
     int numSamples{};
     //==============================================================================
@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    Created: 18 Oct 2026 10:21:05am
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+namespace
+{
+    constexpr int stateMagic = 0x74534d50;   // "PMSt"
+}
+
+//===============================================================================
+PresetBank::PresetBank(AudioProcessorValueTreeState& state)
+    : Thread("Preset bank loader"), stateType(state.state.getType())
+{
+    // Same order as the processor's parameter list, which is fixed once built
+    for (auto* param : state.processor.getParameters())
+        if (auto* ranged = dynamic_cast<RangedAudioParameter*>(param))
+            parameters.add(ranged);
+}
+
+PresetBank::~PresetBank()
+{
+    stopThread(2000);
+}
+
+void PresetBank::loadFolder(const File& folder)
+{
+    stopThread(2000);
+    folderToLoad = folder;
+    startThread();
+}
+
+int PresetBank::getNumPresets() const
+{
+    const SpinLock::ScopedLockType lock(presetsLock);
+    return presets != nullptr ? (int)presets->size() : 0;
+}
+
+String PresetBank::getPresetName(int index) const
+{
+    const SpinLock::ScopedLockType lock(presetsLock);
+
+    if (presets == nullptr || !isPositiveAndBelow(index, (int)presets->size()))
+        return {};
+
+    return (*presets)[(size_t)index].name;
+}
+
+PresetBank::ReadResult PresetBank::readPreset(int index, float* values) noexcept
+{
+    const SpinLock::ScopedTryLockType tryLock(presetsLock);
+
+    if (!tryLock.isLocked())
+        return ReadResult::busy;
+
+    if (presets == nullptr || !isPositiveAndBelow(index, (int)presets->size()))
+        return ReadResult::noSuchPreset;
+
+    const auto& preset = (*presets)[(size_t)index].values;
+
+    for (int i = 0; i < parameters.size(); ++i)
+    {
+        auto* param = parameters.getUnchecked(i);
+        values[param->getParameterIndex()] = param->convertFrom0to1(preset[(size_t)i]);
+    }
+
+    return ReadResult::copied;
+}
+
+void PresetBank::publishPreset(int index)
+{
+    std::vector<float> preset;
+
+    {
+        const SpinLock::ScopedLockType lock(presetsLock);
+
+        if (presets == nullptr || !isPositiveAndBelow(index, (int)presets->size()))
+            return;
+
+        preset = (*presets)[(size_t)index].values;
+    }
+
+    //Outside the lock: the host may ask for program names from inside the callbacks
+    for (int i = 0; i < parameters.size(); ++i)
+        parameters.getUnchecked(i)->setValueNotifyingHost(preset[(size_t)i]);
+}
+
+//===============================================================================
+void PresetBank::run()
+{
+    auto files = folderToLoad.findChildFiles(File::findFiles, false, "*.pms;*.xml");
+    files.sort();
+
+    auto decoded = std::make_unique<Presets>();
+    decoded->reserve((size_t)files.size());
+
+    for (auto& file : files)
+    {
+        if (threadShouldExit())
+            return;
+
+        Preset preset;
+
+        if (decodePreset(file, preset))
+            decoded->push_back(std::move(preset));
+    }
+
+    {
+        const SpinLock::ScopedLockType lock(presetsLock);
+        std::swap(presets, decoded);
+    }
+
+    //The old bank is freed here, outside the lock
+}
+
+bool PresetBank::decodePreset(const File& file, Preset& preset) const
+{
+    ValueTree state;
+
+    if (file.hasFileExtension("xml"))
+    {
+        if (auto xml = parseXML(file))
+            state = ValueTree::fromXml(*xml);
+    }
+    else
+    {
+        MemoryBlock data;
+
+        if (file.loadFileAsData(data))
+            state = decodeState(data.getData(), (int)data.getSize());
+    }
+
+    if (!state.hasType(stateType))
+        return false;
+
+    // Parameters the preset doesn't mention keep their defaults
+    preset.name = file.getFileNameWithoutExtension();
+    preset.values.resize((size_t)parameters.size());
+
+    for (int i = 0; i < parameters.size(); ++i)
+    {
+        auto* param = parameters.getUnchecked(i);
+        auto child = state.getChildWithProperty("id", param->paramID);
+
+        preset.values[(size_t)i] = child.isValid() && child.hasProperty("value")
+                                 ? param->convertTo0to1((float)child.getProperty("value"))
+                                 : param->getDefaultValue();
+    }
+
+    return true;
+}
+
+//===============================================================================
+void PresetBank::encodeState(const ValueTree& state, MemoryBlock& destData)
+{
+    MemoryOutputStream out(destData, false);
+    out.writeInt(stateMagic);
+    out.writeInt(formatVersion);
+
+    GZIPCompressorOutputStream zipped(out);
+    state.writeToStream(zipped);
+}
+
+ValueTree PresetBank::decodeState(const void* data, int sizeInBytes)
+{
+    MemoryInputStream in(data, (size_t)sizeInBytes, false);
+
+    if (sizeInBytes < 8 || in.readInt() != stateMagic)
+        return {};
+
+    const int version = in.readInt();
+
+    if (version < 1 || version > formatVersion)
+        return {};
+
+    GZIPDecompressorInputStream unzipped(in);
+    return ValueTree::readFromStream(unzipped);
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Created: 18 Oct 2026 10:21:05am
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// Folder of presets, decoded on a background thread into plain arrays of
+// normalised parameter values (one per processor parameter, in parameter
+// order). The audio thread only ever try-locks the bank and copies values out
+// of it, so a program change never allocates or waits; the parameters
+// themselves (and the host) are only told from the message thread.
+//
+// Preset files are the plugin's binary state (.pms, see encodeState) or the
+// APVTS XML the offline renderer reads (.xml).
+//===============================================================================
+class PresetBank : private Thread
+{
+public:
+    explicit PresetBank(AudioProcessorValueTreeState& state);
+    ~PresetBank() override;
+
+    // Message thread. Replaces the bank once every file in the folder is decoded;
+    // until then the old bank keeps playing
+    void loadFolder(const File& folder);
+
+    // Blocks until a load in progress has finished (offline renders)
+    void waitForLoad() { waitForThreadToExit(-1); }
+
+    int getNumPresets() const;
+    String getPresetName(int index) const;
+
+    // Audio thread. Copies preset index into values, in plain (not normalised)
+    // units at each parameter's processor index, without touching the parameters.
+    // Busy means the bank is being swapped right now, so try again next block
+    enum class ReadResult { copied, busy, noSuchPreset };
+    ReadResult readPreset(int index, float* values) noexcept;
+
+    // Message thread. Sets every parameter from preset index, notifying the host
+    void publishPreset(int index);
+
+    //===============================================================================
+    // Versioned binary state: magic, format version, then the ValueTree gzipped
+    static constexpr int formatVersion = 1;
+
+    static void encodeState(const ValueTree& state, MemoryBlock& destData);
+
+    // Invalid tree if the data isn't ours or is from a newer format
+    static ValueTree decodeState(const void* data, int sizeInBytes);
+
+private:
+    struct Preset
+    {
+        String name;
+        std::vector<float> values;
+    };
+
+    using Presets = std::vector<Preset>;
+
+    void run() override;
+    bool decodePreset(const File& file, Preset& preset) const;
+
+    Identifier stateType;
+    Array<RangedAudioParameter*> parameters;
+
+    File folderToLoad;
+
+    std::unique_ptr<Presets> presets;
+    SpinLock presetsLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetBank)
+};
@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    RenderWorkerPool.cpp
+    Created: 16 Oct 2026 10:41:17pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "RenderWorkerPool.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #define RENDERPOOL_PAUSE() _mm_pause()
+#else
+ #define RENDERPOOL_PAUSE()
+#endif
+
+//===============================================================================
+RenderWorkerPool::Worker::Worker(RenderWorkerPool& p, int participantIndex)
+    : Thread("String render worker " + String(participantIndex)),
+      pool(p), participant(participantIndex)
+{
+}
+
+void RenderWorkerPool::Worker::run()
+{
+    uint32 seen = pool.generation.load(std::memory_order_acquire);
+    int64 lastWork = Time::getHighResolutionTicks();
+
+    while (!threadShouldExit())
+    {
+        const uint32 current = pool.generation.load(std::memory_order_acquire);
+
+        if (current != seen)
+        {
+            seen = current;
+            pool.workUntilEmpty(participant);
+            lastWork = Time::getHighResolutionTicks();
+            continue;
+        }
+
+        // Not prepared: nothing comes until setParked(false) notifies
+        if (pool.parked.load(std::memory_order_relaxed))
+        {
+            wait(100);
+            lastWork = Time::getHighResolutionTicks();
+            continue;
+        }
+
+        // Spin across the chunks of one callback, give the core away between
+        // callbacks, and once the host has stopped calling, poll every millisecond
+        const int64 idle = Time::getHighResolutionTicks() - lastWork;
+
+        if (idle < pool.spinTicks.load(std::memory_order_relaxed))
+            RENDERPOOL_PAUSE();
+        else if (idle < pool.yieldTicks)
+            Thread::yield();
+        else
+            Thread::sleep(1);
+    }
+}
+
+//===============================================================================
+RenderWorkerPool::~RenderWorkerPool()
+{
+    setNumWorkers(0);
+}
+
+void RenderWorkerPool::setNumWorkers(int numWorkers)
+{
+    numWorkers = jlimit(0, maxWorkers, numWorkers);
+
+    if (numWorkers == workers.size())
+        return;
+
+    for (auto* w : workers)
+    {
+        w->signalThreadShouldExit();
+        w->notify();
+    }
+
+    workers.clear(); // ~Thread waits for each to stop
+
+    numParticipants.store(numWorkers + 1);
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        auto* w = workers.add(new Worker(*this, i + 1));
+        w->startThread(Thread::Priority::highest);
+    }
+}
+
+void RenderWorkerPool::setSpinWindow(double seconds) noexcept
+{
+    spinTicks.store(Time::secondsToHighResolutionTicks(jmax(0.0, seconds)), std::memory_order_relaxed);
+}
+
+void RenderWorkerPool::setParked(bool shouldPark)
+{
+    parked.store(shouldPark);
+
+    if (!shouldPark)
+        for (auto* w : workers)
+            w->notify();
+}
+
+//===============================================================================
+void RenderWorkerPool::workUntilEmpty(int participant) noexcept
+{
+    const int participantsNow = numParticipants.load(std::memory_order_relaxed);
+
+    // Own range first, then steal round the ring
+    for (int offset = 0; offset < participantsNow; offset++)
+    {
+        auto& range = ranges[(size_t)((participant + offset) % participantsNow)];
+
+        for (;;)
+        {
+            const int job = range.next.fetch_add(1, std::memory_order_acq_rel);
+
+            if (job >= range.end.load(std::memory_order_acquire))
+                break;
+
+            jobFunction.load(std::memory_order_relaxed)(jobContext.load(std::memory_order_relaxed), job);
+            remainingJobs.fetch_sub(1, std::memory_order_release);
+        }
+    }
+}
+
+void RenderWorkerPool::run(JobFunction function, void* context, int numJobs) noexcept
+{
+    if (numJobs <= 0)
+        return;
+
+    const int participantsNow = numParticipants.load(std::memory_order_relaxed);
+
+    if (participantsNow == 1 || numJobs == 1)
+    {
+        for (int job = 0; job < numJobs; job++)
+            function(context, job);
+
+        return;
+    }
+
+    jobFunction.store(function, std::memory_order_relaxed);
+    jobContext.store(context, std::memory_order_relaxed);
+    remainingJobs.store(numJobs, std::memory_order_relaxed);
+
+    // Contiguous split; end is published before next so a claim never sees a
+    // fresh start index against a stale end
+    for (int p = 0; p < participantsNow; p++)
+    {
+        const int begin = (int)((int64)numJobs * p / participantsNow);
+        const int end = (int)((int64)numJobs * (p + 1) / participantsNow);
+
+        ranges[(size_t)p].end.store(end, std::memory_order_release);
+        ranges[(size_t)p].next.store(begin, std::memory_order_release);
+    }
+
+    generation.fetch_add(1);
+
+    workUntilEmpty(0);
+
+    while (remainingJobs.load(std::memory_order_acquire) > 0)
+        RENDERPOOL_PAUSE();
+
+    // Every job is claimed, but close the ranges so a worker that is late to
+    // notice this generation can't claim against the next one's end values
+    for (int p = 0; p < participantsNow; p++)
+        ranges[(size_t)p].next.store(closedRange, std::memory_order_release);
+}
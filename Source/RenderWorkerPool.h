@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    RenderWorkerPool.h
+    Created: 16 Oct 2026 10:41:17pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// Fixed set of worker threads for spreading voice rendering over cores.
+//
+// Jobs are pre-split into one contiguous range per participant (the calling
+// thread plus every worker). Each participant claims jobs from its own range
+// with an atomic fetch_add and, once that's empty, steals from the others the
+// same way. Workers pick up a new batch by polling a generation counter, so
+// run() never takes a lock or signals anyone, and never allocates. After its
+// last job a worker spins for a short window (the chunks of one callback arrive
+// back to back), then yields its core between polls. Only a parked pool (not
+// prepared to play) blocks its workers on their thread events. Workers aren't
+// pinned, so several plugin instances share the cores with each other and with
+// the host's own audio threads.
+//===============================================================================
+class RenderWorkerPool
+{
+public:
+    using JobFunction = void (*)(void* context, int jobIndex);
+
+    static constexpr int maxWorkers = 15;
+
+    RenderWorkerPool() = default;
+    ~RenderWorkerPool();
+
+    // Message thread only, never while run() is in progress
+    void setNumWorkers(int numWorkers);
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    // Only meaningful while the worker is running, so read it before the pool goes away
+    Thread::ThreadID getWorkerThreadId(int index) const noexcept { return workers[index]->getThreadId(); }
+
+    // Runs jobs [0, numJobs) on the calling thread and the workers, returns once all are done
+    void run(JobFunction function, void* context, int numJobs) noexcept;
+
+    // How long a worker keeps spinning after its last job before it starts yielding
+    void setSpinWindow(double seconds) noexcept;
+
+    // Message thread. Parked workers block until unparked and cost nothing; park
+    // the pool whenever there won't be callbacks (it starts out parked)
+    void setParked(bool shouldPark);
+    bool isParked() const noexcept { return parked.load(std::memory_order_relaxed); }
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker(RenderWorkerPool& p, int participantIndex);
+        void run() override;
+
+    private:
+        RenderWorkerPool& pool;
+        const int participant;
+    };
+
+    struct alignas(64) JobRange
+    {
+        std::atomic<int> next{ closedRange };
+        std::atomic<int> end{ 0 };
+    };
+
+    static constexpr int closedRange = 1 << 30;
+
+    void workUntilEmpty(int participant) noexcept;
+
+    OwnedArray<Worker> workers;
+    std::array<JobRange, maxWorkers + 1> ranges;
+
+    std::atomic<JobFunction> jobFunction{ nullptr };
+    std::atomic<void*> jobContext{ nullptr };
+    std::atomic<int> numParticipants{ 1 };
+
+    alignas(64) std::atomic<int> remainingJobs{ 0 };
+    alignas(64) std::atomic<uint32> generation{ 0 };
+    std::atomic<int64> spinTicks{ Time::secondsToHighResolutionTicks(0.00025) };
+    std::atomic<bool> parked{ true };
+
+    // Prepared but no callbacks for this long (host stopped calling): poll gently
+    const int64 yieldTicks = Time::secondsToHighResolutionTicks(1.0);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorkerPool)
+};
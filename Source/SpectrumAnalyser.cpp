@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.cpp
+    Created: 17 Oct 2026 1:20:36pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyser.h"
+
+//===============================================================================
+SpectrumAnalyser::SpectrumAnalyser() : Thread("Spectrum analyser")
+{
+    ring.allocate((size_t)ringSize, true);
+    windowTable.allocate((size_t)maxFftSize, true);
+    history.allocate((size_t)maxFftSize, true);
+    fftData.allocate((size_t)maxFftSize * 2, true);
+
+    for (auto& frame : frames)
+    {
+        frame.allocate((size_t)maxFftSize / 2 + 1, false);
+        FloatVectorOperations::fill(frame.get(), minDecibels, maxFftSize / 2 + 1);
+    }
+
+    setUpTransform(defaultFftOrder);
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    release();
+}
+
+void SpectrumAnalyser::prepare(double newSampleRate)
+{
+    release();
+
+    sampleRate = newSampleRate;
+    fifo.reset();
+    FloatVectorOperations::clear(history.get(), maxFftSize);
+    samplesSinceLastFrame = 0;
+
+    startThread(Thread::Priority::low);
+}
+
+void SpectrumAnalyser::release()
+{
+    stopThread(1000);
+}
+
+//===============================================================================
+void SpectrumAnalyser::pushSamples(const float* samples, int numSamples) noexcept
+{
+    // Whatever doesn't fit is dropped; the display just misses those samples
+    const auto scope = fifo.write(numSamples);
+
+    if (scope.blockSize1 > 0)
+        FloatVectorOperations::copy(ring.get() + scope.startIndex1, samples, scope.blockSize1);
+
+    if (scope.blockSize2 > 0)
+        FloatVectorOperations::copy(ring.get() + scope.startIndex2, samples + scope.blockSize1, scope.blockSize2);
+}
+
+bool SpectrumAnalyser::updateLatestSpectrum() noexcept
+{
+    if ((middle.load(std::memory_order_relaxed) & newFrameFlag) == 0)
+        return false;
+
+    front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+    return true;
+}
+
+//===============================================================================
+void SpectrumAnalyser::run()
+{
+    auto appendToHistory = [this](int start, int size)
+    {
+        if (size <= 0)
+            return;
+
+        std::memmove(history.get(), history.get() + size, sizeof(float) * (size_t)(maxFftSize - size));
+        FloatVectorOperations::copy(history.get() + maxFftSize - size, ring.get() + start, size);
+    };
+
+    while (!threadShouldExit())
+    {
+        if (requestedOrder.load() != fftOrder)
+            setUpTransform(requestedOrder.load());
+
+        // Slide each chunk into the analysis window, transforming every hop
+        while (fifo.getNumReady() > 0)
+        {
+            const int toRead = jmin(fifo.getNumReady(), hopSize - samplesSinceLastFrame);
+
+            {
+                const auto scope = fifo.read(toRead);
+                appendToHistory(scope.startIndex1, scope.blockSize1);
+                appendToHistory(scope.startIndex2, scope.blockSize2);
+            }
+
+            samplesSinceLastFrame += toRead;
+
+            if (samplesSinceLastFrame >= hopSize)
+            {
+                samplesSinceLastFrame = 0;
+                analyseFrame();
+            }
+        }
+
+        // One hop at 48 kHz is ~20 ms, polling at 5 ms keeps the display current
+        wait(5);
+    }
+}
+
+void SpectrumAnalyser::setUpTransform(int order)
+{
+    fftOrder = order;
+    fftSize = 1 << order;
+    hopSize = fftSize / 2;
+    samplesSinceLastFrame = 0;
+
+    forwardFFT = std::make_unique<dsp::FFT>(fftOrder);
+
+    dsp::WindowingFunction<float>::fillWindowingTables(windowTable.get(), (size_t)fftSize,
+                                                       dsp::WindowingFunction<float>::hamming, false);
+
+    // A full-scale sine lands on 0 dB: its peak bin is (window sum) / 2
+    float windowSum = 0.0f;
+
+    for (int i = 0; i < fftSize; ++i)
+        windowSum += windowTable[i];
+
+    magnitudeScale = 2.0f / jmax(1.0e-6f, windowSum);
+}
+
+void SpectrumAnalyser::analyseFrame()
+{
+    // Newest fftSize samples of the history
+    FloatVectorOperations::multiply(fftData.get(), history.get() + maxFftSize - fftSize, windowTable.get(), fftSize);
+    FloatVectorOperations::clear(fftData.get() + fftSize, fftSize);
+
+    forwardFFT->performFrequencyOnlyForwardTransform(fftData.get());
+
+    const int numBins = fftSize / 2 + 1;
+    float* frame = frames[(size_t)back].get();
+
+    for (int i = 0; i < numBins; ++i)
+        frame[i] = Decibels::gainToDecibels(fftData[i] * magnitudeScale, minDecibels);
+
+    frameOrders[(size_t)back] = fftOrder;
+    publishFrame();
+}
+
+void SpectrumAnalyser::publishFrame() noexcept
+{
+    back = middle.exchange(back | newFrameFlag, std::memory_order_acq_rel) & indexMask;
+}
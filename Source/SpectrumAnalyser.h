@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.h
+    Created: 17 Oct 2026 1:20:36pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// Spectrum analysis off both the audio and message threads.
+//
+// processBlock copies its output into a single-producer/single-consumer ring
+// (one memcpy, never blocks, drops samples if the worker falls behind). The
+// worker thread windows and transforms each hop and publishes the magnitudes
+// through a triple buffer, so the editor always reads the newest complete
+// frame without a lock and without the writer ever waiting on it.
+//
+// Frames are published in decibels relative to a full-scale sine (the window's
+// coherent gain is divided out), floored at minDecibels, so the editor only
+// has to aggregate and scale them.
+//===============================================================================
+class SpectrumAnalyser : private Thread
+{
+public:
+    static constexpr int minFftOrder = 9;
+    static constexpr int maxFftOrder = 14;
+    static constexpr int defaultFftOrder = 11;
+    static constexpr int maxFftSize = 1 << maxFftOrder;
+    static constexpr float minDecibels = -100.0f;
+
+    SpectrumAnalyser();
+    ~SpectrumAnalyser() override;
+
+    // Start/stop the worker. Not for the audio thread.
+    void prepare(double sampleRate);
+    void release();
+
+    // Audio thread
+    void pushSamples(const float* samples, int numSamples) noexcept;
+
+    // Any thread; the worker switches size before its next frame
+    void setFftOrder(int order) noexcept { requestedOrder.store(jlimit(minFftOrder, maxFftOrder, order)); }
+    int getFftOrder() const noexcept { return requestedOrder.load(); }
+
+    // Message thread: swaps in the newest published frame, false if nothing new
+    bool updateLatestSpectrum() noexcept;
+
+    // Levels in dB of the frame last swapped in by updateLatestSpectrum,
+    // getNumBins() values for bins 0 .. fftSize / 2
+    const float* getSpectrum() const noexcept { return frames[(size_t)front].get(); }
+    int getSpectrumOrder() const noexcept { return frameOrders[(size_t)front]; }
+    int getNumBins() const noexcept { return (1 << getSpectrumOrder()) / 2 + 1; }
+
+    double getSampleRate() const noexcept { return sampleRate; }
+
+private:
+    void run() override;
+    void setUpTransform(int order);
+    void analyseFrame();
+    void publishFrame() noexcept;
+
+    static constexpr int ringSize = maxFftSize * 4;
+
+    // SPSC ring from the audio thread
+    AbstractFifo fifo{ ringSize };
+    HeapBlock<float> ring;
+
+    std::atomic<int> requestedOrder{ defaultFftOrder };
+
+    // Worker-side analysis state, rebuilt on the worker when the size changes
+    std::unique_ptr<dsp::FFT> forwardFFT;
+    HeapBlock<float> windowTable, history, fftData;
+    int fftOrder = 0, fftSize = 0, hopSize = 0;
+    float magnitudeScale = 1.0f;
+    int samplesSinceLastFrame = 0;
+
+    // Triple buffer: the worker owns back, the UI owns front, and the middle
+    // index is exchanged atomically with a flag marking an unread frame
+    static constexpr int newFrameFlag = 4;
+    static constexpr int indexMask = 3;
+
+    std::array<HeapBlock<float>, 3> frames;
+    std::array<int, 3> frameOrders{ defaultFftOrder, defaultFftOrder, defaultFftOrder };
+    std::atomic<int> middle{ 1 };
+    int back = 0;
+    int front = 2;
+
+    double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyser)
+};
@@ -0,0 +1,472 @@
+/*
+  ==============================================================================
+
+    StringBank.cpp
+    Created: 16 Oct 2026 9:32:10pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "StringBank.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+// The AVX2/AVX-512 targets enable FMA, and GCC and Clang would then fuse the
+// multiply-adds below, so the wide kernels would round differently from the
+// scalar one and from WaveguideString. Keep every kernel to separate multiplies
+// and adds so the output doesn't depend on the CPU it runs on.
+#if JUCE_GCC
+ #pragma GCC optimize ("fp-contract=off")
+#elif JUCE_CLANG
+ #pragma clang fp contract(off)
+#endif
+
+// Everything between a push and a pop is built for that instruction set. MSVC
+// takes any intrinsic without a target switch (and never fuses them), so there
+// the kernels build as they are whatever the project's /arch setting.
+#if JUCE_INTEL && JUCE_CLANG
+ #define STRINGBANK_TARGET_PUSH(isa) _Pragma (JUCE_STRINGIFY (clang attribute push (__attribute__ ((target (isa))), apply_to = function)))
+ #define STRINGBANK_TARGET_POP       _Pragma ("clang attribute pop")
+#elif JUCE_INTEL && JUCE_GCC
+ #define STRINGBANK_TARGET_PUSH(isa) _Pragma ("GCC push_options") _Pragma (JUCE_STRINGIFY (GCC target (isa)))
+ #define STRINGBANK_TARGET_POP       _Pragma ("GCC pop_options")
+#else
+ #define STRINGBANK_TARGET_PUSH(isa)
+ #define STRINGBANK_TARGET_POP
+#endif
+
+namespace
+{
+    //===============================================================================
+    // One lane per call: the fallback, the leftover lanes that don't fill a vector,
+    // and the coupled kernel
+    namespace ScalarKernel
+    {
+        struct Lanes
+        {
+            using Float = float;
+            using Int = int;
+            static constexpr int width = 1;
+
+            static forcedinline Float load(const float* p) noexcept             { return *p; }
+            static forcedinline void store(float* p, Float v) noexcept          { *p = v; }
+            static forcedinline Int loadInt(const int* p) noexcept              { return *p; }
+            static forcedinline void storeInt(int* p, Int v) noexcept           { *p = v; }
+            static forcedinline Float splat(float v) noexcept                   { return v; }
+            static forcedinline Int splatInt(int v) noexcept                    { return v; }
+
+            static forcedinline Float add(Float a, Float b) noexcept            { return a + b; }
+            static forcedinline Float sub(Float a, Float b) noexcept            { return a - b; }
+            static forcedinline Float mul(Float a, Float b) noexcept            { return a * b; }
+            static forcedinline Float neg(Float a) noexcept                     { return -a; }
+            static forcedinline Float floor(Float a) noexcept                   { return std::floor(a); }
+            static forcedinline Float select(Float m, Float a, Float b) noexcept { return m != 0.0f ? a : b; }
+
+            static forcedinline Int addInt(Int a, Int b) noexcept               { return a + b; }
+            static forcedinline Int subInt(Int a, Int b) noexcept               { return a - b; }
+            static forcedinline Int andInt(Int a, Int b) noexcept               { return a & b; }
+            static forcedinline Int toInt(Float a) noexcept                     { return (int)a; }
+
+            static forcedinline Float gather(const float* base, Int i) noexcept { return base[i]; }
+            static forcedinline void scatter(float* base, Int i, Float v) noexcept { base[i] = v; }
+        };
+
+        #include "StringBankKernel.h"
+
+        void render(StringBank::LaneArrays& s, int laneBegin, int laneEnd, int numSamples) noexcept
+        {
+            for (int g = laneBegin; g < laneEnd; ++g)
+                renderGroup(s, g, numSamples);
+        }
+    }
+
+   #if JUCE_INTEL
+    //===============================================================================
+    // SSE2 has no gather or scatter, the rail taps go lane by lane through memory
+    STRINGBANK_TARGET_PUSH ("sse2")
+    namespace SSEKernel
+    {
+        struct Lanes
+        {
+            using Float = __m128;
+            using Int = __m128i;
+            static constexpr int width = 4;
+
+            static forcedinline Float load(const float* p) noexcept             { return _mm_loadu_ps(p); }
+            static forcedinline void store(float* p, Float v) noexcept          { _mm_storeu_ps(p, v); }
+            static forcedinline Int loadInt(const int* p) noexcept              { return _mm_loadu_si128((const __m128i*)p); }
+            static forcedinline void storeInt(int* p, Int v) noexcept           { _mm_storeu_si128((__m128i*)p, v); }
+            static forcedinline Float splat(float v) noexcept                   { return _mm_set1_ps(v); }
+            static forcedinline Int splatInt(int v) noexcept                    { return _mm_set1_epi32(v); }
+
+            static forcedinline Float add(Float a, Float b) noexcept            { return _mm_add_ps(a, b); }
+            static forcedinline Float sub(Float a, Float b) noexcept            { return _mm_sub_ps(a, b); }
+            static forcedinline Float mul(Float a, Float b) noexcept            { return _mm_mul_ps(a, b); }
+            static forcedinline Float neg(Float a) noexcept                     { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+
+            // No roundps before SSE4.1: truncate, then step down where that rounded up
+            static forcedinline Float floor(Float a) noexcept
+            {
+                const auto t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+                return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+            }
+
+            static forcedinline Float select(Float m, Float a, Float b) noexcept
+            {
+                const auto set = _mm_cmpneq_ps(m, _mm_setzero_ps());
+                return _mm_or_ps(_mm_and_ps(set, a), _mm_andnot_ps(set, b));
+            }
+
+            static forcedinline Int addInt(Int a, Int b) noexcept               { return _mm_add_epi32(a, b); }
+            static forcedinline Int subInt(Int a, Int b) noexcept               { return _mm_sub_epi32(a, b); }
+            static forcedinline Int andInt(Int a, Int b) noexcept               { return _mm_and_si128(a, b); }
+            static forcedinline Int toInt(Float a) noexcept                     { return _mm_cvttps_epi32(a); }
+
+            static forcedinline Float gather(const float* base, Int i) noexcept
+            {
+                alignas (16) int at[width];
+                _mm_store_si128((__m128i*)at, i);
+                return _mm_setr_ps(base[at[0]], base[at[1]], base[at[2]], base[at[3]]);
+            }
+
+            static forcedinline void scatter(float* base, Int i, Float v) noexcept
+            {
+                alignas (16) int at[width];
+                alignas (16) float values[width];
+                _mm_store_si128((__m128i*)at, i);
+                _mm_store_ps(values, v);
+
+                for (int k = 0; k < width; ++k)
+                    base[at[k]] = values[k];
+            }
+        };
+
+        #include "StringBankKernel.h"
+
+        void render(StringBank::LaneArrays& s, int laneBegin, int laneEnd, int numSamples) noexcept
+        {
+            int g = laneBegin;
+
+            for (; g + Lanes::width <= laneEnd; g += Lanes::width)
+                renderGroup(s, g, numSamples);
+
+            ScalarKernel::render(s, g, laneEnd, numSamples);
+        }
+    }
+    STRINGBANK_TARGET_POP
+
+    //===============================================================================
+    // AVX2 gathers the rail taps; stores still go lane by lane
+    STRINGBANK_TARGET_PUSH ("avx2")
+    namespace AVX2Kernel
+    {
+        struct Lanes
+        {
+            using Float = __m256;
+            using Int = __m256i;
+            static constexpr int width = 8;
+
+            static forcedinline Float load(const float* p) noexcept             { return _mm256_loadu_ps(p); }
+            static forcedinline void store(float* p, Float v) noexcept          { _mm256_storeu_ps(p, v); }
+            static forcedinline Int loadInt(const int* p) noexcept              { return _mm256_loadu_si256((const __m256i*)p); }
+            static forcedinline void storeInt(int* p, Int v) noexcept           { _mm256_storeu_si256((__m256i*)p, v); }
+            static forcedinline Float splat(float v) noexcept                   { return _mm256_set1_ps(v); }
+            static forcedinline Int splatInt(int v) noexcept                    { return _mm256_set1_epi32(v); }
+
+            static forcedinline Float add(Float a, Float b) noexcept            { return _mm256_add_ps(a, b); }
+            static forcedinline Float sub(Float a, Float b) noexcept            { return _mm256_sub_ps(a, b); }
+            static forcedinline Float mul(Float a, Float b) noexcept            { return _mm256_mul_ps(a, b); }
+            static forcedinline Float neg(Float a) noexcept                     { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+            static forcedinline Float floor(Float a) noexcept                   { return _mm256_floor_ps(a); }
+
+            static forcedinline Float select(Float m, Float a, Float b) noexcept
+            {
+                return _mm256_blendv_ps(b, a, _mm256_cmp_ps(m, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+            }
+
+            static forcedinline Int addInt(Int a, Int b) noexcept               { return _mm256_add_epi32(a, b); }
+            static forcedinline Int subInt(Int a, Int b) noexcept               { return _mm256_sub_epi32(a, b); }
+            static forcedinline Int andInt(Int a, Int b) noexcept               { return _mm256_and_si256(a, b); }
+            static forcedinline Int toInt(Float a) noexcept                     { return _mm256_cvttps_epi32(a); }
+
+            static forcedinline Float gather(const float* base, Int i) noexcept { return _mm256_i32gather_ps(base, i, 4); }
+
+            static forcedinline void scatter(float* base, Int i, Float v) noexcept
+            {
+                alignas (32) int at[width];
+                alignas (32) float values[width];
+                _mm256_store_si256((__m256i*)at, i);
+                _mm256_store_ps(values, v);
+
+                for (int k = 0; k < width; ++k)
+                    base[at[k]] = values[k];
+            }
+        };
+
+        #include "StringBankKernel.h"
+
+        void render(StringBank::LaneArrays& s, int laneBegin, int laneEnd, int numSamples) noexcept
+        {
+            int g = laneBegin;
+
+            for (; g + Lanes::width <= laneEnd; g += Lanes::width)
+                renderGroup(s, g, numSamples);
+
+            ScalarKernel::render(s, g, laneEnd, numSamples);
+        }
+    }
+    STRINGBANK_TARGET_POP
+
+    //===============================================================================
+    // AVX-512 gathers and scatters the rail taps. Lanes never share a rail, so the
+    // scatters can't collide.
+    STRINGBANK_TARGET_PUSH ("avx512f")
+    namespace AVX512Kernel
+    {
+        struct Lanes
+        {
+            using Float = __m512;
+            using Int = __m512i;
+            static constexpr int width = 16;
+
+            static forcedinline Float load(const float* p) noexcept             { return _mm512_loadu_ps(p); }
+            static forcedinline void store(float* p, Float v) noexcept          { _mm512_storeu_ps(p, v); }
+            static forcedinline Int loadInt(const int* p) noexcept              { return _mm512_loadu_si512(p); }
+            static forcedinline void storeInt(int* p, Int v) noexcept           { _mm512_storeu_si512(p, v); }
+            static forcedinline Float splat(float v) noexcept                   { return _mm512_set1_ps(v); }
+            static forcedinline Int splatInt(int v) noexcept                    { return _mm512_set1_epi32(v); }
+
+            static forcedinline Float add(Float a, Float b) noexcept            { return _mm512_add_ps(a, b); }
+            static forcedinline Float sub(Float a, Float b) noexcept            { return _mm512_sub_ps(a, b); }
+            static forcedinline Float mul(Float a, Float b) noexcept            { return _mm512_mul_ps(a, b); }
+
+            // AVX-512F has no float xor (that's DQ), flip the sign bit as an int
+            static forcedinline Float neg(Float a) noexcept
+            {
+                return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32((int)0x80000000)));
+            }
+
+            static forcedinline Float floor(Float a) noexcept                   { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+            static forcedinline Float select(Float m, Float a, Float b) noexcept
+            {
+                return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(m, _mm512_setzero_ps(), _CMP_NEQ_UQ), b, a);
+            }
+
+            static forcedinline Int addInt(Int a, Int b) noexcept               { return _mm512_add_epi32(a, b); }
+            static forcedinline Int subInt(Int a, Int b) noexcept               { return _mm512_sub_epi32(a, b); }
+            static forcedinline Int andInt(Int a, Int b) noexcept               { return _mm512_and_si512(a, b); }
+            static forcedinline Int toInt(Float a) noexcept                     { return _mm512_cvttps_epi32(a); }
+
+            static forcedinline Float gather(const float* base, Int i) noexcept { return _mm512_i32gather_ps(i, base, 4); }
+            static forcedinline void scatter(float* base, Int i, Float v) noexcept { _mm512_i32scatter_ps(base, i, v, 4); }
+        };
+
+        #include "StringBankKernel.h"
+
+        void render(StringBank::LaneArrays& s, int laneBegin, int laneEnd, int numSamples) noexcept
+        {
+            int g = laneBegin;
+
+            for (; g + Lanes::width <= laneEnd; g += Lanes::width)
+                renderGroup(s, g, numSamples);
+
+            ScalarKernel::render(s, g, laneEnd, numSamples);
+        }
+    }
+    STRINGBANK_TARGET_POP
+   #endif
+
+    //===============================================================================
+    // Coupled bridge. Lane state stays in the arrays, since every sample needs all
+    // lanes' bridge inputs before any lane can reflect: one pass moves the waves
+    // and sums what arrives at the bridge, the second reflects each string about
+    // the shared bridge velocity. With equal string impedances and a bridge of
+    // admittance a, the junction is passive for any number of strings. The junction
+    // sum runs in lane order, so it stays scalar and rounds the same on every CPU.
+    void renderCoupled(StringBank::LaneArrays& s, int numLanes, int numSamples, float kappa) noexcept
+    {
+        using ScalarKernel::readBridge;
+
+        float* const base = s.railBase;
+
+        for (int k = 0; k < numLanes; ++k)
+            s.energyDelta[k] = 0.0f;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            float junction = 0.0f;
+
+            for (int k = 0; k < numLanes; ++k)
+            {
+                const int msk = s.mask[k], lo = s.leftOffset[k], ro = s.rightOffset[k], tap = s.bridgeTap[k];
+
+                const float leaving = base[lo + s.leftHead[k]];
+                const int lh = s.leftHead[k] = (s.leftHead[k] + 1) & msk;
+                const int rh = s.rightHead[k] = (s.rightHead[k] - 1) & msk;
+
+                const float nut = -base[lo + lh];
+                base[ro + rh] = nut;
+
+                const float leavingRight = base[ro + ((rh + tap + 1) & msk)];
+                s.energyDelta[k] += nut * nut - leaving * leaving - leavingRight * leavingRight;
+
+                s.r[k] += s.rStep[k];
+                s.b0[k] += s.b0Step[k]; s.b1[k] += s.b1Step[k]; s.b2[k] += s.b2Step[k];
+                s.a1[k] += s.a1Step[k]; s.a2[k] += s.a2Step[k];
+                s.readOffset[k] += s.readOffsetStep[k];
+
+                const float in = readBridge(base, ro, rh, tap, msk, s.readOffset[k]);
+                const float y = s.b0[k] * in + s.z1[k];
+                s.z1[k] = s.b1[k] * in - s.a1[k] * y + s.z2[k];
+                s.z2[k] = s.b2[k] * in - s.a2[k] * y;
+
+                const float tunedY = s.tuningCoeff[k] * y + s.tuningState[k];
+                s.tuningState[k] = y - s.tuningCoeff[k] * tunedY;
+
+                const float arriving = s.tuningMix[k] != 0.0f ? tunedY : y;
+                s.arriving[k] = arriving;
+                junction += s.weight[k] * arriving;
+            }
+
+            const float bridgeVelocity = kappa * junction;
+
+            for (int k = 0; k < numLanes; ++k)
+            {
+                const int msk = s.mask[k], lo = s.leftOffset[k], ro = s.rightOffset[k];
+                const int lh = s.leftHead[k], rh = s.rightHead[k];
+
+                // Rigid bridge (kappa = 0) is the uncoupled -r * arriving
+                const float bridge = s.r[k] * (bridgeVelocity * s.invWeight[k] - s.arriving[k]);
+                base[lo + ((lh + s.bridgeTap[k]) & msk)] = bridge;
+                s.energyDelta[k] += bridge * bridge;
+
+                s.output[(size_t)k * (size_t)s.outputStride + (size_t)n] = base[lo + ((lh + s.pickup[k]) & msk)]
+                                                                         + base[ro + ((rh + s.pickup[k]) & msk)];
+            }
+        }
+    }
+}
+
+//===============================================================================
+StringBank::StringBank()
+{
+    kernel = ScalarKernel::render;
+    isa = Isa::Scalar;
+
+   #if JUCE_INTEL
+    if (SystemStats::hasAVX512F())
+    {
+        kernel = AVX512Kernel::render;
+        isa = Isa::AVX512;
+    }
+    else if (SystemStats::hasAVX2())
+    {
+        kernel = AVX2Kernel::render;
+        isa = Isa::AVX2;
+    }
+    else if (SystemStats::hasSSE2())
+    {
+        kernel = SSEKernel::render;
+        isa = Isa::SSE;
+    }
+   #endif
+}
+
+void StringBank::prepare(int lanesNeeded, int maxBlockSize)
+{
+    maxLanes = juce::jmax(1, lanesNeeded);
+    numLanes = 0;
+
+    for (auto* block : { &lanes.leftOffset, &lanes.rightOffset, &lanes.leftHead, &lanes.rightHead,
+                         &lanes.mask, &lanes.bridgeTap, &lanes.pickup })
+        block->allocate((size_t)maxLanes, true);
+
+    for (auto* block : { &lanes.r, &lanes.b0, &lanes.b1, &lanes.b2, &lanes.a1, &lanes.a2, &lanes.z1, &lanes.z2,
+                         &lanes.rStep, &lanes.b0Step, &lanes.b1Step, &lanes.b2Step, &lanes.a1Step, &lanes.a2Step,
+                         &lanes.tuningCoeff, &lanes.tuningState, &lanes.tuningMix, &lanes.energyDelta,
+                         &lanes.weight, &lanes.invWeight, &lanes.arriving,
+                         &lanes.readOffset, &lanes.readOffsetStep })
+        block->allocate((size_t)maxLanes, true);
+
+    lanes.outputStride = juce::jmax(1, maxBlockSize);
+    lanes.output.allocate((size_t)maxLanes * (size_t)lanes.outputStride, true);
+}
+
+int StringBank::addLane(const WaveguideString<float>& string, float weight) noexcept
+{
+    jassert(numLanes < maxLanes && lanes.railBase != nullptr);
+
+    const int lane = numLanes++;
+
+    lanes.leftOffset[lane] = (int)(string.Left - lanes.railBase);
+    lanes.rightOffset[lane] = (int)(string.Right - lanes.railBase);
+    lanes.leftHead[lane] = string.leftHead;
+    lanes.rightHead[lane] = string.rightHead;
+    lanes.mask[lane] = string.mask;
+    lanes.bridgeTap[lane] = string.L - 1;
+    lanes.pickup[lane] = string.pickup;
+
+    lanes.r[lane] = string.r;
+    lanes.b0[lane] = string.loss.b0;
+    lanes.b1[lane] = string.loss.b1;
+    lanes.b2[lane] = string.loss.b2;
+    lanes.a1[lane] = string.loss.a1;
+    lanes.a2[lane] = string.loss.a2;
+    lanes.z1[lane] = string.loss.z1;
+    lanes.z2[lane] = string.loss.z2;
+
+    lanes.rStep[lane] = string.rStep;
+    lanes.b0Step[lane] = string.b0Step;
+    lanes.b1Step[lane] = string.b1Step;
+    lanes.b2Step[lane] = string.b2Step;
+    lanes.a1Step[lane] = string.a1Step;
+    lanes.a2Step[lane] = string.a2Step;
+
+    lanes.tuningCoeff[lane] = string.tuningCoeff;
+    lanes.tuningState[lane] = string.tuningState;
+    lanes.tuningMix[lane] = string.tuned ? 1.0f : 0.0f;
+
+    lanes.energyDelta[lane] = 0.0f;
+
+    lanes.readOffset[lane] = string.readOffset;
+    lanes.readOffsetStep[lane] = string.readOffsetStep;
+
+    lanes.weight[lane] = weight;
+    lanes.invWeight[lane] = 1.0f / juce::jmax(weight, 1.0e-3f);
+
+    return lane;
+}
+
+void StringBank::storeLane(int lane, WaveguideString<float>& string) const noexcept
+{
+    string.leftHead = lanes.leftHead[lane];
+    string.rightHead = lanes.rightHead[lane];
+    string.loss.z1 = lanes.z1[lane];
+    string.loss.z2 = lanes.z2[lane];
+    string.tuningState = lanes.tuningState[lane];
+    string.energy += (double)lanes.energyDelta[lane];
+
+    // The lane ramped r, the coefficients and the read offset; the string jumps to
+    // the exact targets
+    string.finishRamp();
+}
+
+void StringBank::process(int laneBegin, int laneEnd, int numSamples) noexcept
+{
+    jassert(numSamples <= lanes.outputStride);
+    kernel(lanes, laneBegin, laneEnd, numSamples);
+}
+
+void StringBank::processCoupled(int numSamples, float bridgeAdmittance) noexcept
+{
+    jassert(numSamples <= lanes.outputStride);
+
+    // Bridge velocity = kappa * sum of arriving waves, kappa = 2 / (Z_bridge + N Z_string)
+    // with the string impedance as the unit
+    const float kappa = 2.0f * bridgeAdmittance / (1.0f + bridgeAdmittance * (float)numLanes);
+    renderCoupled(lanes, numLanes, numSamples, kappa);
+}
@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    StringBank.h
+    Created: 16 Oct 2026 9:32:10pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Waveguide.h"
+
+using namespace juce;
+
+//===============================================================================
+// Voice-parallel waveguide renderer.
+//
+// The per-voice string state (rail offsets, heads, reflection coefficient,
+// loss filter state and pickup tap) is gathered into structure-of-arrays lanes
+// at the start of a block, every lane is advanced in lockstep, and the state
+// is written back to the voices afterwards. Each lane is one element of a
+// vector register (16 with AVX-512, 8 with AVX2, 4 with SSE, picked at runtime,
+// with a scalar fallback); only the rail taps are gathered lane by lane.
+//
+// With bridge coupling on, every lane's bridge becomes one port of a shared
+// junction: each sample the waves arriving at the bridge are summed once (O(N))
+// into the bridge velocity and every string reflects relative to it.
+//===============================================================================
+class StringBank
+{
+public:
+    enum class Isa { Scalar, SSE, AVX2, AVX512 };
+
+    StringBank();
+
+    void prepare(int maxLanes, int maxBlockSize);
+
+    // Every rail handed to addLane must live in the slab starting at base
+    void setRailBase(float* base) noexcept { lanes.railBase = base; }
+
+    void clear() noexcept { numLanes = 0; }
+    // weight is the string's output gain (its velocity), so the junction sees the
+    // strings at the levels they're heard at
+    int addLane(const WaveguideString<float>& string, float weight = 1.0f) noexcept;
+    void storeLane(int lane, WaveguideString<float>& string) const noexcept;
+
+    // Renders lanes [laneBegin, laneEnd) into their output rows
+    void process(int laneBegin, int laneEnd, int numSamples) noexcept;
+    void process(int numSamples) noexcept { process(0, numLanes, numSamples); }
+
+    // All lanes through one shared bridge of the given admittance (relative to one
+    // string, 0 = rigid, same as process). Sample-major, so single threaded.
+    void processCoupled(int numSamples, float bridgeAdmittance) noexcept;
+
+    const float* getLaneOutput(int lane) const noexcept { return lanes.output.get() + (size_t)lane * (size_t)lanes.outputStride; }
+
+    int getNumLanes() const noexcept { return numLanes; }
+    int getMaxLanes() const noexcept { return maxLanes; }
+    int getMaxBlockSize() const noexcept { return lanes.outputStride; }
+    Isa getIsa() const noexcept { return isa; }
+
+    // Trades lane storage with a bank prepared elsewhere; pointer swaps only
+    void swapWith(StringBank& other) noexcept
+    {
+        std::swap(lanes, other.lanes);
+        std::swap(numLanes, other.numLanes);
+        std::swap(maxLanes, other.maxLanes);
+    }
+
+    struct LaneArrays
+    {
+        float* railBase = nullptr;
+
+        HeapBlock<int> leftOffset, rightOffset, leftHead, rightHead, mask, bridgeTap, pickup;
+        HeapBlock<float> r, b0, b1, b2, a1, a2, z1, z2;
+
+        // Per-sample increments of r and the loss coefficients (zero unless the
+        // voice is ramping a parameter this chunk)
+        HeapBlock<float> rStep, b0Step, b1Step, b2Step, a1Step, a2Step;
+
+        // Fine tuning allpass; tuningMix is 1 for tuned strings and 0 for the rest,
+        // which pass the loss filter output straight through (every lane runs the
+        // allpass, the mix only picks which output reflects)
+        HeapBlock<float> tuningCoeff, tuningState, tuningMix;
+
+        // Fractional bridge read position (pitch bend/vibrato) and its per-sample step
+        HeapBlock<float> readOffset, readOffsetStep;
+
+        // Energy change over the block, folded into the string's running total on store
+        HeapBlock<float> energyDelta;
+
+        // Coupled bridge: output gain per lane and its inverse, plus per-sample
+        // scratch for the wave arriving at the bridge
+        HeapBlock<float> weight, invWeight, arriving;
+
+        HeapBlock<float> output;
+        int outputStride = 0;
+    };
+
+private:
+    using Kernel = void (*)(LaneArrays&, int, int, int);
+
+    LaneArrays lanes;
+    Kernel kernel = nullptr;
+    Isa isa = Isa::Scalar;
+
+    int numLanes = 0;
+    int maxLanes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StringBank)
+};
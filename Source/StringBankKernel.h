@@ -0,0 +1,176 @@
+/*
+  ==============================================================================
+
+    StringBankKernel.h
+    Created: 16 Oct 2026 9:32:10pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+// No include guard: StringBank.cpp includes this once per instruction set, each
+// time inside a namespace that defines Lanes (the vector type and its ops) and
+// with that instruction set enabled for everything defined here.
+
+//===============================================================================
+// Rail sample at (head-relative) index i, wrapped, for every lane
+forcedinline Lanes::Float readRail(const float* base, Lanes::Int railOffset, Lanes::Int i, Lanes::Int msk) noexcept
+{
+    return Lanes::gather(base, Lanes::addInt(railOffset, Lanes::andInt(i, msk)));
+}
+
+// Right rail at the bridge tap moved by a fractional offset, cubic Lagrange as
+// in WaveguideString::readBridge (so both paths stay bit-identical)
+forcedinline Lanes::Float readBridge(const float* base, Lanes::Int ro, Lanes::Int rh, Lanes::Int tap,
+                                     Lanes::Int msk, Lanes::Float offset) noexcept
+{
+    const auto one = Lanes::splat(1.0f), two = Lanes::splat(2.0f);
+    const auto half = Lanes::splat(0.5f), sixth = Lanes::splat(1.0f / 6.0f);
+
+    const auto whole = Lanes::floor(offset);
+    const auto d = Lanes::sub(offset, whole);
+    const auto i = Lanes::addInt(Lanes::addInt(rh, tap), Lanes::toInt(whole));
+
+    const auto xm1 = readRail(base, ro, Lanes::subInt(i, Lanes::splatInt(1)), msk);
+    const auto x0 = readRail(base, ro, i, msk);
+    const auto x1 = readRail(base, ro, Lanes::addInt(i, Lanes::splatInt(1)), msk);
+    const auto x2 = readRail(base, ro, Lanes::addInt(i, Lanes::splatInt(2)), msk);
+
+    const auto dm1 = Lanes::sub(d, one), dm2 = Lanes::sub(d, two), dp1 = Lanes::add(d, one);
+
+    const auto wm1 = Lanes::mul(Lanes::mul(Lanes::mul(Lanes::neg(d), dm1), dm2), sixth);
+    const auto w0 = Lanes::mul(Lanes::mul(Lanes::mul(dp1, dm1), dm2), half);
+    const auto w1 = Lanes::mul(Lanes::mul(Lanes::mul(Lanes::neg(dp1), d), dm2), half);
+    const auto w2 = Lanes::mul(Lanes::mul(Lanes::mul(dp1, d), dm1), sixth);
+
+    return Lanes::add(Lanes::add(Lanes::add(Lanes::mul(xm1, wm1), Lanes::mul(x0, w0)),
+                                 Lanes::mul(x1, w1)),
+                      Lanes::mul(x2, w2));
+}
+
+//===============================================================================
+// Advances Lanes::width lanes starting at g through numSamples. All the lane
+// state sits in vector registers for the block; only the rail taps go through
+// memory, gathered and scattered per lane since every lane has its own rails.
+// Without Fractional every lane's read offset is flat and whole, and the bridge
+// is one direct tap instead of four interpolated ones.
+template <bool Fractional>
+forcedinline void renderGroup(StringBank::LaneArrays& s, int g, int numSamples) noexcept
+{
+    float* const base = s.railBase;
+
+    const auto lo = Lanes::loadInt(s.leftOffset.get() + g), ro = Lanes::loadInt(s.rightOffset.get() + g);
+    const auto msk = Lanes::loadInt(s.mask.get() + g), tap = Lanes::loadInt(s.bridgeTap.get() + g);
+    const auto pick = Lanes::loadInt(s.pickup.get() + g);
+    auto lh = Lanes::loadInt(s.leftHead.get() + g), rh = Lanes::loadInt(s.rightHead.get() + g);
+
+    auto r = Lanes::load(s.r.get() + g);
+    auto b0 = Lanes::load(s.b0.get() + g), b1 = Lanes::load(s.b1.get() + g), b2 = Lanes::load(s.b2.get() + g);
+    auto a1 = Lanes::load(s.a1.get() + g), a2 = Lanes::load(s.a2.get() + g);
+    auto z1 = Lanes::load(s.z1.get() + g), z2 = Lanes::load(s.z2.get() + g);
+
+    const auto dr = Lanes::load(s.rStep.get() + g);
+    const auto db0 = Lanes::load(s.b0Step.get() + g), db1 = Lanes::load(s.b1Step.get() + g), db2 = Lanes::load(s.b2Step.get() + g);
+    const auto da1 = Lanes::load(s.a1Step.get() + g), da2 = Lanes::load(s.a2Step.get() + g);
+
+    const auto apc = Lanes::load(s.tuningCoeff.get() + g), apm = Lanes::load(s.tuningMix.get() + g);
+    auto aps = Lanes::load(s.tuningState.get() + g);
+
+    auto off = Lanes::load(s.readOffset.get() + g);
+    const auto doff = Lanes::load(s.readOffsetStep.get() + g);
+    const auto wholeOffset = Lanes::toInt(off);
+
+    const auto one = Lanes::splatInt(1);
+
+    // Output rows of this group's lanes
+    int rows[Lanes::width];
+
+    for (int k = 0; k < Lanes::width; ++k)
+        rows[k] = k * s.outputStride;
+
+    const auto outRows = Lanes::loadInt(rows);
+    float* const out = s.output.get() + (size_t)g * (size_t)s.outputStride;
+
+    // What leaves the left rail at the nut comes straight back as the next nut
+    // reflection, so over the block the left rail's losses cancel against the nut
+    // gains except for the first sample leaving and the last one reflected; only
+    // the right rail needs a read per sample for the energy tracking
+    auto nut = Lanes::neg(Lanes::gather(base, Lanes::addInt(lo, lh)));
+    auto energy = Lanes::neg(Lanes::mul(nut, nut));
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        // Head steps for both rails
+        lh = Lanes::andInt(Lanes::addInt(lh, one), msk);
+        rh = Lanes::andInt(Lanes::subInt(rh, one), msk);
+
+        // Nut reflection (*-1) into the start of the right-going rail
+        nut = Lanes::neg(Lanes::gather(base, Lanes::addInt(lo, lh)));
+        Lanes::scatter(base, Lanes::addInt(ro, rh), nut);
+
+        const auto leavingRight = readRail(base, ro, Lanes::addInt(Lanes::addInt(rh, tap), one), msk);
+
+        // Parameter ramps, a plain add per lane so there's no branch
+        r = Lanes::add(r, dr);
+        b0 = Lanes::add(b0, db0); b1 = Lanes::add(b1, db1); b2 = Lanes::add(b2, db2);
+        a1 = Lanes::add(a1, da1); a2 = Lanes::add(a2, da2);
+
+        // Bridge: lumped loss filter (TDF-II biquad) and reflection coefficient
+        Lanes::Float in;
+
+        if constexpr (Fractional)
+        {
+            off = Lanes::add(off, doff);
+            in = readBridge(base, ro, rh, tap, msk, off);
+        }
+        else
+        {
+            in = readRail(base, ro, Lanes::addInt(Lanes::addInt(rh, tap), wholeOffset), msk);
+        }
+
+        const auto y = Lanes::add(Lanes::mul(b0, in), z1);
+        z1 = Lanes::add(Lanes::sub(Lanes::mul(b1, in), Lanes::mul(a1, y)), z2);
+        z2 = Lanes::sub(Lanes::mul(b2, in), Lanes::mul(a2, y));
+
+        const auto tunedY = Lanes::add(Lanes::mul(apc, y), aps);
+        aps = Lanes::sub(y, Lanes::mul(apc, tunedY));
+
+        // A select rather than a blend, so tuned lanes reflect exactly tunedY
+        const auto bridge = Lanes::mul(Lanes::neg(r), Lanes::select(apm, tunedY, y));
+        Lanes::scatter(base, Lanes::addInt(lo, Lanes::andInt(Lanes::addInt(lh, tap), msk)), bridge);
+
+        energy = Lanes::add(energy, Lanes::sub(Lanes::mul(bridge, bridge), Lanes::mul(leavingRight, leavingRight)));
+
+        // Pickup tap
+        const auto leftPick = readRail(base, lo, Lanes::addInt(lh, pick), msk);
+        const auto rightPick = readRail(base, ro, Lanes::addInt(rh, pick), msk);
+        Lanes::scatter(out + n, outRows, Lanes::add(leftPick, rightPick));
+    }
+
+    energy = Lanes::add(energy, Lanes::mul(nut, nut));
+
+    Lanes::storeInt(s.leftHead.get() + g, lh);
+    Lanes::storeInt(s.rightHead.get() + g, rh);
+    Lanes::store(s.z1.get() + g, z1);
+    Lanes::store(s.z2.get() + g, z2);
+    Lanes::store(s.tuningState.get() + g, aps);
+    Lanes::store(s.energyDelta.get() + g, energy);
+}
+
+// True when every lane of the group can take the direct bridge read
+forcedinline bool hasWholeReadOffsets(const StringBank::LaneArrays& s, int g) noexcept
+{
+    for (int k = g; k < g + Lanes::width; ++k)
+        if (s.readOffsetStep[k] != 0.0f || s.readOffset[k] != std::floor(s.readOffset[k]))
+            return false;
+
+    return true;
+}
+
+forcedinline void renderGroup(StringBank::LaneArrays& s, int g, int numSamples) noexcept
+{
+    if (hasWholeReadOffsets(s, g))
+        renderGroup<false>(s, g, numSamples);
+    else
+        renderGroup<true>(s, g, numSamples);
+}
@@ -0,0 +1,531 @@
+/*
+  ==============================================================================
+
+    StringSynthesiser.cpp
+    Created: 16 Oct 2026 9:58:41pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "StringSynthesiser.h"
+
+//===============================================================================
+StringSynthesiser::StringSynthesiser()
+{
+    //Room for every voice up front, so filling this per block never grows it
+    laneVoices.ensureStorageAllocated(maxPolyphony);
+}
+
+void StringSynthesiser::prepare(double sampleRate, int samplesPerBlock, int outputChannels, bool useDoublePrecision)
+{
+    setCurrentPlaybackSampleRate(sampleRate);
+
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+    preparedChannels = outputChannels;
+    preparedDoublePrecision = useDoublePrecision;
+
+    for (int i = 0; i < getNumVoices(); i++)
+        getStringVoice(i)->prepareToPlay(sampleRate, samplesPerBlock, outputChannels, useDoublePrecision);
+
+    //Voices have let go of the other precision's rails by now
+    if (useDoublePrecision)
+    {
+        assignRails(preciseArena, sampleRate);
+        delayLineArena.release();
+    }
+    else
+    {
+        assignRails(delayLineArena, sampleRate);
+        preciseArena.release();
+    }
+
+    bank.prepare(getNumVoices(), samplesPerBlock);
+    bank.setRailBase(delayLineArena.getLeftRail(0));
+
+    workerPool->setSpinWindow(getWorkerSpinWindow());
+    workerPool->setParked(false);
+
+    laneVoices.clearQuick();
+}
+
+void StringSynthesiser::releaseResources()
+{
+    //No callbacks until the next prepare, so the workers can stop polling
+    workerPool->setParked(true);
+}
+
+template <typename SampleType>
+void StringSynthesiser::assignRails(DelayLineArena<SampleType>& arena, double sampleRate)
+{
+    //Delay lines for every voice sized for the lowest note at this sample rate
+    if (!arena.prepare(sampleRate, getNumVoices()))
+        return;
+
+    for (int i = 0; i < getNumVoices(); i++)
+        getStringVoice(i)->setDelayLineStorage(arena.getLeftRail(i), arena.getRightRail(i), arena.getRailCapacity());
+}
+
+template <typename SampleType>
+void StringSynthesiser::moveRails(DelayLineArena<SampleType>& newArena, DelayLineArena<SampleType>& arena) noexcept
+{
+    //Re-slot every voice in the new arena, carrying ringing strings across
+    for (int i = 0; i < getNumVoices(); i++)
+        getStringVoice(i)->moveDelayLineStorage(newArena.getLeftRail(i),
+                                                newArena.getRightRail(i),
+                                                newArena.getRailCapacity());
+
+    arena.swapWith(newArena);
+}
+
+void StringSynthesiser::setPolyphony(int numVoices)
+{
+    jassert(voiceFactory != nullptr);
+
+    numVoices = jlimit(minPolyphony, maxPolyphony, numVoices);
+
+    if (numVoices == getNumVoices())
+        return;
+
+    //Everything that allocates happens before the audio thread is held up, and
+    //everything that frees after it's let go (these locals outlive the lock)
+    OwnedArray<SynthVoice> newVoices;
+    OwnedArray<SynthesiserVoice> nextVoices, removedVoices;
+    nextVoices.ensureStorageAllocated(numVoices);
+    removedVoices.ensureStorageAllocated(jmax(0, getNumVoices() - numVoices));
+
+    for (int i = getNumVoices(); i < numVoices; i++)
+    {
+        auto* voice = newVoices.add(voiceFactory());
+        voice->setCurrentPlaybackSampleRate(getSampleRate());
+
+        if (preparedSampleRate > 0.0)
+            voice->prepareToPlay(preparedSampleRate, preparedBlockSize, preparedChannels, preparedDoublePrecision);
+    }
+
+    DelayLineArena<float> newArena;
+    DelayLineArena<double> newPreciseArena;
+    StringBank newBank;
+
+    if (preparedSampleRate > 0.0)
+    {
+        if (preparedDoublePrecision)
+            newPreciseArena.prepare(preparedSampleRate, numVoices);
+        else
+            newArena.prepare(preparedSampleRate, numVoices);
+
+        newBank.prepare(numVoices, preparedBlockSize);
+    }
+
+    const ScopedLock sl(lock);
+
+    //Shrinking drops silent voices first, then the highest index ones. The new
+    //list goes into storage reserved above and is swapped in whole, since removing
+    //from voices can shrink (reallocate) it
+    int toDrop = getNumVoices() - numVoices;
+
+    for (int i = getNumVoices(); --i >= 0 && toDrop > 0;)
+    {
+        if (!getStringVoice(i)->isVoiceActive())
+        {
+            removedVoices.add(voices.getUnchecked(i));
+            --toDrop;
+        }
+    }
+
+    for (int i = getNumVoices(); --i >= 0 && toDrop > 0;)
+    {
+        if (!removedVoices.contains(voices.getUnchecked(i)))
+        {
+            removedVoices.add(voices.getUnchecked(i));
+            --toDrop;
+        }
+    }
+
+    for (auto* voice : voices)
+        if (!removedVoices.contains(voice))
+            nextVoices.add(voice);
+
+    for (auto* voice : newVoices)
+        nextVoices.add(voice);
+
+    newVoices.clearQuick(false);
+    voices.swapWith(nextVoices);
+    nextVoices.clearQuick(false);   // the old list; its voices are either kept or in removedVoices
+
+    if (preparedSampleRate > 0.0)
+    {
+        if (preparedDoublePrecision)
+            moveRails(newPreciseArena, preciseArena);
+        else
+            moveRails(newArena, delayLineArena);
+
+        bank.swapWith(newBank);
+        bank.setRailBase(delayLineArena.getLeftRail(0));
+    }
+}
+
+//===============================================================================
+SynthesiserVoice* StringSynthesiser::findFreeVoice(SynthesiserSound* soundToPlay, int midiChannel,
+                                                   int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+    const float budget = costBudget.load();
+
+    if (budget > 0.0f && getSampleRate() > 0.0 && getNumVoices() > 0)
+    {
+        const ScopedLock sl(lock);
+
+        float activeCost = 0.0f;
+
+        for (int i = 0; i < getNumVoices(); i++)
+            if (getStringVoice(i)->isVoiceActive())
+                activeCost += getStringVoice(i)->getRenderCost();
+
+        //Over budget: take over a sounding voice rather than add to the load. With
+        //nothing sounding to steal the note is dropped
+        if (activeCost + getStringVoice(0)->getRenderCostForNote(midiNoteNumber) > budget)
+            return stealIfNoneAvailable ? findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber) : nullptr;
+    }
+
+    return Synthesiser::findFreeVoice(soundToPlay, midiChannel, midiNoteNumber, stealIfNoneAvailable);
+}
+
+SynthesiserVoice* StringSynthesiser::findVoiceToSteal(SynthesiserSound* soundToPlay, int midiChannel,
+                                                      int midiNoteNumber) const
+{
+    juce::ignoreUnused(midiChannel, midiNoteNumber);
+
+    //Lower score = better to steal. Quiet, old and expensive (long) strings go
+    //first, and anything whose key is still held is only taken as a last resort
+    constexpr float ageWeight = 0.25f;
+    constexpr float costWeight = 0.5f;
+    constexpr double ageHorizonSeconds = 4.0;
+
+    SynthesiserVoice* best = nullptr;
+    float bestScore = std::numeric_limits<float>::max();
+
+    for (int i = 0; i < getNumVoices(); i++)
+    {
+        auto* voice = getStringVoice(i);
+
+        //A free voice frees no budget, and the note would just add its cost back
+        if (!voice->isVoiceActive() || !voice->canPlaySound(soundToPlay))
+            continue;
+
+        const float age = (float)jmin(1.0, voice->getSecondsSinceNoteOn() / ageHorizonSeconds);
+        const float cost = 1.0f - 1.0f / voice->getRenderCost();
+
+        float score = voice->getStealEnergy() - ageWeight * age - costWeight * cost;
+
+        if (voice->isKeyDown())
+            score += 1.0f;
+
+        if (score < bestScore)
+        {
+            bestScore = score;
+            best = voice;
+        }
+    }
+
+    return best;
+}
+
+float StringSynthesiser::getNewestPeriodInSamples() const
+{
+    const ScopedLock sl(lock);
+
+    const SynthVoice* newest = nullptr;
+
+    for (int i = 0; i < getNumVoices(); i++)
+    {
+        auto* voice = getStringVoice(i);
+
+        if (voice->isVoiceActive() && voice->isResonating()
+            && (newest == nullptr || voice->getSecondsSinceNoteOn() < newest->getSecondsSinceNoteOn()))
+            newest = voice;
+    }
+
+    return newest != nullptr ? newest->getPeriodInSamples() : 0.0f;
+}
+
+//===============================================================================
+void StringSynthesiser::handleController(int midiChannel, int controllerNumber, int controllerValue)
+{
+    if (controllerNumber == 1)
+        for (int i = 0; i < getNumVoices(); i++)
+            getStringVoice(i)->setModWheel(midiChannel, (float)controllerValue / 127.0f);
+
+    Synthesiser::handleController(midiChannel, controllerNumber, controllerValue);
+}
+
+void StringSynthesiser::noteOn(int midiChannel, int midiNoteNumber, float velocity)
+{
+    if (midiNoteNumber < DelayLineArena<float>::lowestMidiNote)
+        return;
+
+    const auto start = PerformanceCounters::startTimer();
+    Synthesiser::noteOn(midiChannel, midiNoteNumber, velocity);
+    performanceCounters.recordNoteOn(start);
+}
+
+int StringSynthesiser::getNumActiveVoices() const noexcept
+{
+    int active = 0;
+
+    for (int i = 0; i < getNumVoices(); i++)
+        if (getStringVoice(i)->isVoiceActive())
+            ++active;
+
+    return active;
+}
+
+//===============================================================================
+void StringSynthesiser::setNumRenderThreads(int numThreads)
+{
+    numThreads = jlimit(0, RenderWorkerPool::maxWorkers, numThreads);
+
+    if (numThreads == workerPool->getNumWorkers())
+        return;
+
+    auto newPool = std::make_unique<RenderWorkerPool>();
+    newPool->setNumWorkers(numThreads);
+    newPool->setSpinWindow(getWorkerSpinWindow());
+    newPool->setParked(workerPool->isParked());
+
+    {
+        // The audio thread only ever sees a whole pool; this is all it waits for
+        const ScopedLock sl(lock);
+        std::swap(workerPool, newPool);
+    }
+
+    //Join the old pool's workers, then hand their counter slots to the next ones
+    Array<Thread::ThreadID> stoppedWorkers;
+
+    for (int i = 0; i < newPool->getNumWorkers(); i++)
+        stoppedWorkers.add(newPool->getWorkerThreadId(i));
+
+    newPool.reset();
+
+    for (auto id : stoppedWorkers)
+        performanceCounters.releaseThread(id);
+}
+
+double StringSynthesiser::getWorkerSpinWindow() const noexcept
+{
+    //A quarter of a block, so workers stay hot across one callback's chunks but
+    //yield their cores between callbacks, and never more than half a millisecond
+    if (preparedSampleRate <= 0.0)
+        return 0.00025;
+
+    return jmin(0.0005, 0.25 * preparedBlockSize / preparedSampleRate);
+}
+
+//===============================================================================
+void StringSynthesiser::renderLaneGroup(void* context, int job) noexcept
+{
+    auto& self = *static_cast<StringSynthesiser*>(context);
+    const int begin = job * laneGroupSize;
+    const int end = jmin(begin + laneGroupSize, self.bank.getNumLanes());
+
+    const auto start = PerformanceCounters::startTimer();
+    self.bank.process(begin, end, self.currentChunk);
+    self.performanceCounters.recordVoiceRender(start, end - begin, self.currentChunk);
+}
+
+//===============================================================================
+template <typename SampleType>
+void StringSynthesiser::renderEachVoice(AudioBuffer<SampleType>& outputAudio, int startSample, int numSamples)
+{
+    // Same as Synthesiser::renderVoices, but with each sounding voice timed
+    for (int i = 0; i < getNumVoices(); i++)
+    {
+        auto* voice = getStringVoice(i);
+        const bool sounding = voice->isVoiceActive();
+        const auto start = PerformanceCounters::startTimer();
+
+        voice->renderNextBlock(outputAudio, startSample, numSamples);
+
+        if (sounding)
+            performanceCounters.recordVoiceRender(start, 1, numSamples);
+    }
+}
+
+void StringSynthesiser::renderVoices(AudioBuffer<double>& outputAudio, int startSample, int numSamples)
+{
+    // The bank is float only, so double strings couple through their own loop
+    if (bridgeCoupling.load(std::memory_order_relaxed) > 0.0f)
+        renderCoupledPrecise(outputAudio, startSample, numSamples);
+    else
+        renderEachVoice(outputAudio, startSample, numSamples);
+}
+
+void StringSynthesiser::renderCoupledPrecise(AudioBuffer<double>& outputAudio, int startSample, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        int chunk = jmin(numSamples, bank.getMaxBlockSize());
+        const double coupling = (double)bridgeCoupling.load(std::memory_order_relaxed);
+
+        laneVoices.clearQuick();
+
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            auto* voice = getStringVoice(i);
+
+            if (voice->isVoiceActive() && voice->couplesAtBridge() && voice->getPreciseString().isActive())
+            {
+                laneVoices.add(voice);
+
+                if (voice->hasVibrato())
+                    chunk = jmin(chunk, SynthVoice::vibratoBlockSize);
+            }
+        }
+
+        const int numStrings = laneVoices.size();
+        const auto start = PerformanceCounters::startTimer();
+
+        for (auto* voice : laneVoices)
+            voice->updateStringParameters(chunk);
+
+        // Same junction as StringBank::processCoupled, sample-major over the strings
+        const double kappa = 2.0 * coupling / (1.0 + coupling * (double)numStrings);
+
+        for (int n = 0; n < chunk; n++)
+        {
+            double junction = 0.0;
+
+            for (auto* voice : laneVoices)
+                junction += (double)voice->getLevel() * voice->getPreciseString().arriveAtBridge();
+
+            const double bridgeVelocity = kappa * junction;
+
+            for (auto* voice : laneVoices)
+            {
+                auto& string = voice->getPreciseString();
+                string.reflectAtBridge(bridgeVelocity / jmax((double)voice->getLevel(), 1.0e-3));
+                voice->getPreciseOutput()[n] = string.pickupSample();
+            }
+        }
+
+        for (auto* voice : laneVoices)
+        {
+            voice->getPreciseString().finishRamp();
+            voice->renderFromString(voice->getPreciseOutput(), outputAudio, startSample, chunk);
+        }
+
+        performanceCounters.recordVoiceRender(start, numStrings, chunk);
+
+        // Oversampled strings and mode banks render on their own
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            auto* voice = getStringVoice(i);
+
+            if (!voice->couplesAtBridge() && voice->isVoiceActive())
+            {
+                const auto voiceStart = PerformanceCounters::startTimer();
+                voice->renderNextBlock(outputAudio, startSample, chunk);
+                performanceCounters.recordVoiceRender(voiceStart, 1, chunk);
+            }
+        }
+
+        startSample += chunk;
+        numSamples -= chunk;
+    }
+}
+
+void StringSynthesiser::renderVoices(AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    if (!lockstepRendering)
+    {
+        renderEachVoice(outputAudio, startSample, numSamples);
+        return;
+    }
+
+    while (numSamples > 0)
+    {
+        int chunk = jmin(numSamples, bank.getMaxBlockSize());
+        const float coupling = bridgeCoupling.load(std::memory_order_relaxed);
+
+        // Lanes share one chunk, so a single string with vibrato shortens it for all
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            auto* voice = getStringVoice(i);
+
+            if (voice->isVoiceActive() && voice->hasVibrato())
+            {
+                chunk = jmin(chunk, SynthVoice::vibratoBlockSize);
+                break;
+            }
+        }
+
+        // Gather every sounding string into a lane
+        bank.clear();
+        laneVoices.clearQuick();
+
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            auto* voice = getStringVoice(i);
+
+            if (voice->isVoiceActive() && voice->rendersThroughBank() && voice->getString().isActive())
+            {
+                voice->updateStringParameters(chunk);
+                bank.addLane(voice->getString(), voice->getLevel());
+                laneVoices.add(voice);
+            }
+        }
+
+        const int numLanes = bank.getNumLanes();
+
+        if (coupling > 0.0f)
+        {
+            const auto start = PerformanceCounters::startTimer();
+            bank.processCoupled(chunk, coupling);
+            performanceCounters.recordVoiceRender(start, numLanes, chunk);
+        }
+        else if (workerPool->getNumWorkers() > 0 && numLanes >= parallelMinLanes)
+        {
+            // Each lane group is timed on the thread that ran it
+            currentChunk = chunk;
+            workerPool->run(renderLaneGroup, this, (numLanes + laneGroupSize - 1) / laneGroupSize);
+        }
+        else
+        {
+            const auto start = PerformanceCounters::startTimer();
+            bank.process(chunk);
+            performanceCounters.recordVoiceRender(start, numLanes, chunk);
+        }
+
+        // Write lane state back, then envelope and mix each voice in voice order
+        // on this thread, so the sum is deterministic
+        {
+            const auto start = PerformanceCounters::startTimer();
+
+            for (int lane = 0; lane < laneVoices.size(); lane++)
+            {
+                auto* voice = laneVoices.getUnchecked(lane);
+                bank.storeLane(lane, voice->getString());
+                voice->renderFromString(bank.getLaneOutput(lane), outputAudio, startSample, chunk);
+            }
+
+            // Already counted as voice-samples above, this only adds the time
+            performanceCounters.recordVoiceRender(start, 0, chunk);
+        }
+
+        // Oversampled strings and mode banks take the per-voice path
+        for (int i = 0; i < getNumVoices(); i++)
+        {
+            auto* voice = getStringVoice(i);
+
+            if (!voice->rendersThroughBank() && voice->isVoiceActive())
+            {
+                const auto start = PerformanceCounters::startTimer();
+                voice->renderNextBlock(outputAudio, startSample, chunk);
+                performanceCounters.recordVoiceRender(start, 1, chunk);
+            }
+        }
+
+        startSample += chunk;
+        numSamples -= chunk;
+    }
+}
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    StringSynthesiser.h
+    Created: 16 Oct 2026 9:58:41pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SynthVoice.h"
+#include "StringBank.h"
+#include "RenderWorkerPool.h"
+#include "PerformanceCounters.h"
+
+using namespace juce;
+
+//===============================================================================
+// Synthesiser that owns the voices' delay line arena and, instead of letting
+// each SynthVoice render on its own, advances every active string in lockstep
+// through the StringBank.
+//
+// Prepared for double precision, every voice runs its own double string and
+// the bank (whose lanes are float) sits idle.
+//===============================================================================
+class StringSynthesiser : public Synthesiser
+{
+public:
+    StringSynthesiser();
+
+    void prepare(double sampleRate, int samplesPerBlock, int outputChannels, bool useDoublePrecision = false);
+
+    // Parks the render workers until the next prepare
+    void releaseResources();
+
+    //===============================================================================
+    static constexpr int minPolyphony = 8;
+    static constexpr int maxPolyphony = 256;
+
+    void setVoiceFactory(std::function<SynthVoice*()> factory) { voiceFactory = std::move(factory); }
+
+    // Message thread only. New voices, their delay lines and the bank's lanes are
+    // built before the synth lock is taken, and dropped voices and the old storage
+    // are freed after it; under it, strings that are sounding are moved across
+    void setPolyphony(int numVoices);
+
+    // Sum of SynthVoice::getRenderCost over sounding voices that a new note may
+    // not push past; beyond it a voice is stolen instead (0 = no budget)
+    void setCostBudget(float budget) noexcept { costBudget.store(budget); }
+
+    // Admittance of the shared bridge relative to one string, 0 = rigid (every
+    // string on its own). Coupled strings render sample-major on the calling
+    // thread; float strings couple in the lockstep path, double ones always
+    void setBridgeCoupling(float admittance) noexcept { bridgeCoupling.store(admittance, std::memory_order_relaxed); }
+
+    void setLockstepRendering(bool shouldUseBank) noexcept { lockstepRendering = shouldUseBank; }
+    bool isLockstepRendering() const noexcept { return lockstepRendering; }
+
+    StringBank::Isa getBankIsa() const noexcept { return bank.getIsa(); }
+
+    // Worker threads for the lockstep lanes (0 = render on the calling thread only).
+    // Output is bit-identical whatever the thread count. Message thread only: the
+    // new pool's threads start, and the old one's are joined, outside the synth lock
+    void setNumRenderThreads(int numThreads);
+    int getNumRenderThreads() const noexcept { return workerPool->getNumWorkers(); }
+
+    // Below this many sounding strings the work stays on the calling thread
+    void setParallelThreshold(int minLanes) noexcept { parallelMinLanes = jmax(1, minLanes); }
+
+    // Period of the most recently started string still sounding, 0 if none
+    float getNewestPeriodInSamples() const;
+
+    // Mod wheel goes to every voice, not just the ones on its channel, so notes
+    // started afterwards pick it up
+    void handleController(int midiChannel, int controllerNumber, int controllerValue) override;
+
+    // Timed as a whole (voice search, stealing, startNote) into the counters.
+    // Notes below the arena's lowest note are ignored
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) override;
+
+    //===============================================================================
+    // Voice render and note-on cost land here from whichever thread did the work;
+    // the processor adds block timing on its audio thread
+    PerformanceCounters& getPerformanceCounters() noexcept { return performanceCounters; }
+
+    // Audio thread
+    int getNumActiveVoices() const noexcept;
+
+protected:
+    void renderVoices(AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+    void renderVoices(AudioBuffer<double>& outputAudio, int startSample, int numSamples) override;
+
+    SynthesiserVoice* findFreeVoice(SynthesiserSound* soundToPlay, int midiChannel,
+                                    int midiNoteNumber, bool stealIfNoneAvailable) const override;
+    SynthesiserVoice* findVoiceToSteal(SynthesiserSound* soundToPlay, int midiChannel,
+                                       int midiNoteNumber) const override;
+
+private:
+    // Lanes per job, a multiple of the widest vector so every job sees the same
+    // lane grouping as a single-threaded pass
+    static constexpr int laneGroupSize = 16;
+
+    static void renderLaneGroup(void* context, int job) noexcept;
+
+    // How long render workers spin before yielding, from the prepared block size
+    double getWorkerSpinWindow() const noexcept;
+
+    // Double strings through a shared bridge, like StringBank::processCoupled
+    void renderCoupledPrecise(AudioBuffer<double>& outputAudio, int startSample, int numSamples);
+
+    // Each sounding voice on its own, timed
+    template <typename SampleType>
+    void renderEachVoice(AudioBuffer<SampleType>& outputAudio, int startSample, int numSamples);
+
+    template <typename SampleType>
+    void assignRails(DelayLineArena<SampleType>& arena, double sampleRate);
+
+    template <typename SampleType>
+    void moveRails(DelayLineArena<SampleType>& newArena, DelayLineArena<SampleType>& arena) noexcept;
+
+    SynthVoice* getStringVoice(int index) const noexcept { return static_cast<SynthVoice*>(voices.getUnchecked(index)); }
+
+    std::function<SynthVoice*()> voiceFactory;
+
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+    int preparedChannels = 0;
+    bool preparedDoublePrecision = false;
+
+    std::atomic<float> costBudget{ 0.0f };
+    std::atomic<float> bridgeCoupling{ 0.0f };
+
+    // Only the arena for the prepared precision holds any memory
+    DelayLineArena<float> delayLineArena;
+    DelayLineArena<double> preciseArena;
+    StringBank bank;
+    std::unique_ptr<RenderWorkerPool> workerPool = std::make_unique<RenderWorkerPool>();
+
+    int parallelMinLanes = 32;
+    int currentChunk = 0;
+
+    Array<SynthVoice*> laneVoices;
+
+    PerformanceCounters performanceCounters;
+
+    bool lockstepRendering = true;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StringSynthesiser)
+};
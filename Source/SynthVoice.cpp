@@ -19,17 +19,88 @@ SynthVoice::SynthVoice(Physical_Model_StringAudioProcessor* pSynth) :
 {
     synth = pSynth;
     frequency = level = 0;
-
-    Right.resize(L);
-    Left.resize(L);
 }
 
 SynthVoice::~SynthVoice() {}
 //===============================================================================
-void SynthVoice::prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels)
+void SynthVoice::prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels, bool useDoublePrecision)
 {
     SampleRate = sampleRate;
     MainADSR.setSampleRate(sampleRate);
+
+    smoothedBRC.reset(sampleRate, parameterRampSeconds);
+    smoothedCutoff.reset(sampleRate, parameterRampSeconds);
+
+    //A ringing string can't cross to the other precision's rails
+    if (useDoublePrecision != doublePrecision)
+    {
+        L = 0;
+        clearCurrentNote();
+        MainADSR.reset();
+    }
+
+    doublePrecision = useDoublePrecision;
+
+    //Scratch blocks for the string output, envelope and enveloped mono signal
+    scratchSize = juce::jmax(1, samplesPerBlock);
+    allocateScratch(floatPath);
+
+    if (doublePrecision)
+    {
+        allocateScratch(doublePath);
+        floatPath.string.releaseStorage();
+    }
+    else
+    {
+        doublePath.string.releaseStorage();
+
+        for (auto* block : { &doublePath.output, &doublePath.envelope, &doublePath.mono, &doublePath.oversampled })
+            block->free();
+    }
+
+    modes.prepare(sampleRate);
+}
+
+template <typename SampleType>
+void SynthVoice::allocateScratch(StringPath<SampleType>& path)
+{
+    path.output.allocate((size_t)scratchSize, true);
+    path.envelope.allocate((size_t)scratchSize, true);
+    path.mono.allocate((size_t)scratchSize, true);
+    path.oversampled.allocate((size_t)(scratchSize * maxOversampling), true);
+}
+
+void SynthVoice::setDelayLineStorage(float* leftRail, float* rightRail, int railCapacity)   { assignStorage(leftRail, rightRail, railCapacity); }
+void SynthVoice::setDelayLineStorage(double* leftRail, double* rightRail, int railCapacity) { assignStorage(leftRail, rightRail, railCapacity); }
+void SynthVoice::moveDelayLineStorage(float* leftRail, float* rightRail, int railCapacity)  { moveStorage(leftRail, rightRail, railCapacity); }
+void SynthVoice::moveDelayLineStorage(double* leftRail, double* rightRail, int railCapacity) { moveStorage(leftRail, rightRail, railCapacity); }
+
+template <typename SampleType>
+void SynthVoice::assignStorage(SampleType* leftRail, SampleType* rightRail, int railCapacity)
+{
+    jassert((std::is_same_v<SampleType, double> == doublePrecision));
+
+    getPath<SampleType>().string.setStorage(leftRail, rightRail, railCapacity);
+    L = 0;
+}
+
+template <typename SampleType>
+void SynthVoice::moveStorage(SampleType* leftRail, SampleType* rightRail, int railCapacity)
+{
+    auto& string = getPath<SampleType>().string;
+
+    if (railCapacity == string.getCapacity())
+    {
+        string.relocate(leftRail, rightRail);
+    }
+    else
+    {
+        //Different sample rate, nothing in the old rails is usable
+        string.setStorage(leftRail, rightRail, railCapacity);
+        L = 0;
+        clearCurrentNote();
+        MainADSR.reset();
+    }
 }
 
 //===============================================================================
@@ -48,27 +119,124 @@ void SynthVoice::setADSR(float Attack, float Decay, float Sustain, float Release
 
 void SynthVoice::startNote(int midiNoteNumber, float velocity, SynthesiserSound* sound, int currentPitchWheelPosition)
 {
-    synth->getChainSettings(chainsettings);
+    chainsettings = synth->getParameterSnapshot();
 
     setADSR(chainsettings.Attack, chainsettings.Decay, chainsettings.Sustain, chainsettings.Release);
     r = chainsettings.BridgeRefCoeff;
 
+    smoothedBRC.setCurrentAndTargetValue(r);
+    smoothedCutoff.setCurrentAndTargetValue(chainsettings.LossCutoff);
+
     level = velocity;
     frequency = MidiMessage::getMidiNoteInHertz(midiNoteNumber);
 
+    lastEnvelope = 0.0f;
+    samplesSinceNoteOn = 0;
+
+    //Channel this note is on, for its per-channel (MPE) pitch wheel and mod wheel
+    for (int channel = 1; channel <= 16; ++channel)
+        if (isPlayingChannel(channel))
+            midiChannel = channel;
+
+    pitchWheel = currentPitchWheelPosition;
+    vibratoPhase = 0.0;
+
+    retireGain = juce::Decibels::decibelsToGain(chainsettings.RetireThresholdDb, -1000.0f);
+
     MainADSR.noteOn();
 
+    modal = chainsettings.Model == VoiceModel::Modal;
+
+    if (modal)
+    {
+        startModes();
+        return;
+    }
+
+    modes.clear();
+
+    if (doublePrecision)
+        startString(doublePath);
+    else
+        startString(floatPath);
+}
+
+template <typename SampleType>
+void SynthVoice::startString(StringPath<SampleType>& path)
+{
+    auto& string = path.string;
+    using Waveguide = WaveguideString<SampleType>;
+
+    const bool adaptive = chainsettings.AdaptiveQuality && frequency > 0.0f && SampleRate > 0.0;
+    const double exactLength = frequency > 0.0f ? SampleRate / frequency : 0.0;
+
+    oversampling = getOversamplingFor(exactLength, adaptive);
+
+    const double stringRate = SampleRate * oversampling;
+    const double w = MathConstants<double>::twoPi * frequency / stringRate;
+
+    //Loop delay the string should have: twice the exact period length
+    const double targetLoopDelay = 2.0 * exactLength * oversampling;
+    const double loopW = targetLoopDelay > 0.0 ? MathConstants<double>::twoPi / targetLoopDelay : 0.0;
+
+    // loss filter first, in adaptive mode its delay decides the length
+    string.setLossFilter(chainsettings.LossType, stringRate, chainsettings.LossCutoff);
+    string.setDispersion(chainsettings.Inharmonicity, loopW);
+
     if (frequency <= 0.0f || SampleRate <= 0.0)
     {
         L = 1;
     }
+    else if (adaptive)
+    {
+        //Whole samples up to within 0.5..2.5 of the target, the allpass does the rest
+        const double lossDelay = string.getLossFilter().getPhaseDelay(w);
+        L = juce::jmax(2, (int)std::floor((targetLoopDelay + 2.0 - lossDelay - 0.5) * 0.5));
+    }
     else
     {
         //samples per period
         L = static_cast<int>(std::floor(SampleRate / frequency));
+
+        //The dispersion cascade can be a good part of the loop at the fundamental
+        if (string.hasDispersion())
+            L -= (int)std::lround(0.5 * string.getLossFilter().getPhaseDelay(loopW));
+
         if (L < 2) L = 2;
     }
 
+    //A read offset can shorten the loop by at most L-2 samples, about an octave.
+    //If the bend range plus vibrato goes further up, start a shorter string and
+    //let the offset make up the difference at rest (whole samples, so no
+    //interpolation until the pitch actually moves)
+    restReadOffset = 0.0f;
+
+    if (frequency > 0.0f && SampleRate > 0.0)
+    {
+        const double restLoopDelay = adaptive ? targetLoopDelay
+                                              : Waveguide::getLoopDelay(L, string.getLossFilter(), w);
+        const float maxUpSemitones = chainsettings.PitchBendRange + chainsettings.VibratoDepth;
+        const double shortestLoopDelay = restLoopDelay * std::exp2(-maxUpSemitones / 12.0);
+        const int shorterL = (int)std::floor(shortestLoopDelay - restLoopDelay + 2.0 * L - 2.0);
+
+        if (shorterL < L)
+        {
+            const int newL = juce::jmax(2, shorterL);
+            restReadOffset = (float)(2 * (L - newL));
+            L = newL;
+        }
+    }
+
+    //arena is sized for the lowest note, this only trips if it hasn't been prepared
+    if (L > string.getCapacity())
+    {
+        jassertfalse;
+        L = 0;
+        MainADSR.reset();
+        clearCurrentNote();
+        return;
+    }
+
     // pluck position (0 .. L-1)
     if (chainsettings.PluckPos == 0) {
         pluck = 0.1f;
@@ -80,21 +248,68 @@ void SynthVoice::startNote(int midiNoteNumber, float velocity, SynthesiserSound*
 
     pickup = static_cast<int>(std::floor(L / 2.0f));
 
-    // create excitation
-    x = createPluckShape(pluck, L);
+    // create excitation in place in the preallocated delay line
+    Excitation<SampleType>::fill(chainsettings.Excitation, string.getExcitationBuffer(), L, (float)pluck, getCurrentlyPlayingNote());
+
+    // load delay lines AFTER L is known
+    string.start(L, pickup, r);
 
-    // resize delay lines AFTER L is known
-    Left.assign(L, 0.0f);
-    Right.assign(L, 0.0f);
+    const double loopDelay = Waveguide::getLoopDelay(L, string.getLossFilter(), w);
 
-    for (int i = 0; i < L; ++i)
+    if (adaptive)
     {
-        Left[i] = x[i] * 0.5f;
-        Right[i] = x[i] * 0.5f;
+        string.setTuning(Waveguide::getTuningCoefficient(targetLoopDelay - restReadOffset - loopDelay, w));
+
+        for (auto& decimator : path.decimators)
+            decimator.reset();
     }
+
+    //A negative reflection coefficient inverts each round trip, doubling the period
+    baseLoopDelay = adaptive ? targetLoopDelay : loopDelay + restReadOffset;
+    basePeriod = (float)(baseLoopDelay * (r < 0.0f ? 2.0 : 1.0) / oversampling);
+
+    //Furthest the bridge read can move down for the bend range plus full vibrato;
+    //that much of the rail past L is zeroed now so a bend never reads an old note
+    const float maxDownSemitones = chainsettings.PitchBendRange + chainsettings.VibratoDepth;
+    maxReadOffset = restReadOffset + (float)(baseLoopDelay * (std::exp2(maxDownSemitones / 12.0) - 1.0));
+    string.clearReadHistory((int)std::ceil(maxReadOffset));
+
+    const float ratio = getPitchRatio(chainsettings);
+    string.jumpReadOffset(getReadOffsetFor(ratio));
+    periodInSamples = basePeriod / ratio;
 }
 
 
+void SynthVoice::startModes()
+{
+    oversampling = 1;
+    floatPath.string.clear();
+    doublePath.string.clear();
+    L = 0;
+
+    //Same controls as the string: BRC is the loop gain per period, so it sets how
+    //long the fundamental rings, and the loss cutoff is where decay speeds up
+    const float loopGain = juce::jlimit(0.5f, 0.999f, std::abs(r));
+
+    ModalResonator::Settings settings;
+    settings.frequency = frequency;
+    settings.inharmonicity = chainsettings.Inharmonicity;
+    settings.strikePosition = chainsettings.PluckPos;
+    settings.decaySeconds = frequency > 0.0f ? -3.0f / (frequency * std::log10(loopGain)) : 0.0f;
+    settings.brightness = chainsettings.LossCutoff;
+
+    modes.start(settings);
+
+    if (!modes.isActive())
+    {
+        MainADSR.reset();
+        clearCurrentNote();
+        return;
+    }
+
+    periodInSamples = (float)(SampleRate / frequency);
+}
+
 void SynthVoice::stopNote(float velocity, bool allowTailOff)
 {
     MainADSR.noteOff(); 
@@ -106,92 +321,281 @@ void SynthVoice::stopNote(float velocity, bool allowTailOff)
     }
 }
 //===============================================================================
-void SynthVoice::pitchWheelMoved(int newPitchWheelValue) {}
-//===============================================================================
-void SynthVoice::controllerMoved(int controllerNumber, int newControllerValue) {}
+void SynthVoice::pitchWheelMoved(int newPitchWheelValue)
+{
+    //Picked up by the next updateStringParameters, which ramps the string there
+    pitchWheel = newPitchWheelValue;
+}
 //===============================================================================
-std::vector<float> SynthVoice::createPluckShape(float pluck, int L) 
+void SynthVoice::controllerMoved(int controllerNumber, int newControllerValue)
+{
+    if (controllerNumber == 1)
+        setModWheel(midiChannel, (float)newControllerValue / 127.0f);
+}
+
+void SynthVoice::setModWheel(int channel, float value) noexcept
+{
+    if (channel >= 1 && channel <= 16)
+        modWheel[(size_t)channel] = value;
+}
+
+float SynthVoice::getPitchRatio(const ChainSettings& params) const noexcept
 {
-    int pluckIndex = std::floor(pluck);
-    std::vector<float> x;
-    x.reserve(L);
+    const float bend = (float)(pitchWheel - 8192) / 8192.0f * params.PitchBendRange;
+    const float vibrato = params.VibratoDepth * modWheel[(size_t)midiChannel] * (float)std::sin(vibratoPhase);
+
+    return std::exp2((bend + vibrato) / 12.0f);
+}
+
+int SynthVoice::getOversamplingFor(double exactLength, bool adaptive) noexcept
+{
+    int factor = 1;
+
+    if (adaptive)
+        while (factor < maxOversampling && exactLength * factor < minAdaptiveLength)
+            factor *= 2;
+
+    return factor;
+}
+
+float SynthVoice::getRenderCostForNote(int midiNoteNumber) const
+{
+    const auto& params = synth->getParameterSnapshot();
+    const float noteFrequency = (float)MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+
+    if (params.Model == VoiceModel::Modal)
+    {
+        ModalResonator::Settings settings;
+        settings.frequency = noteFrequency;
+        settings.inharmonicity = params.Inharmonicity;
+        settings.strikePosition = params.PluckPos;
+
+        return getModalRenderCostFor(ModalResonator::countModes(settings, SampleRate));
+    }
 
-    // First segment: rising ramp (0 to 1)
-    for (int i = 0; i <= pluckIndex; ++i)
-        x.push_back(static_cast<float>(i) / pluck);
+    //L lands within a sample or two of the exact length at the string's rate
+    const double exactLength = SampleRate / noteFrequency;
+    const int factor = getOversamplingFor(exactLength, params.AdaptiveQuality && SampleRate > 0.0);
 
-    // Second segment: falling ramp (1 to 0)
-    for (int i = pluckIndex + 1; i < L; ++i)
-        x.push_back((L - 1 - i) / (L - 1 - pluck));
+    return (float)factor * getRenderCostFor((int)(exactLength * factor));
+}
 
-    return x;
+bool SynthVoice::hasVibrato() const noexcept
+{
+    return !modal && modWheel[(size_t)midiChannel] > 0.0f && synth->getParameterSnapshot().VibratoDepth > 0.0f;
 }
 
+float SynthVoice::getReadOffsetFor(float ratio) const noexcept
+{
+    //Loop delay scales with the period; the string's L stays as it is
+    return juce::jmin(maxReadOffset, restReadOffset + (float)(baseLoopDelay * (1.0 / ratio - 1.0)));
+}
 void SynthVoice::renderNextBlock(AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    renderVoice(outputBuffer, startSample, numSamples);
+}
+
+void SynthVoice::renderNextBlock(AudioBuffer<double>& outputBuffer, int startSample, int numSamples)
+{
+    renderVoice(outputBuffer, startSample, numSamples);
+}
+
+template <typename SampleType>
+void SynthVoice::renderVoice(AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples)
 {
     juce::ScopedNoDenormals noDenormals;
 
-    if (L < 2 || Left.empty() || Right.empty())
+    //The host only calls the overload matching the precision we were prepared for
+    if (std::is_same_v<SampleType, double> != doublePrecision)
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto& path = getPath<SampleType>();
+    SampleType* output = path.output.get();
+
+    if (modal ? !modes.isActive() : (L < 2 || !path.string.isActive()))
         return;
 
     //========= Main Waveguide Loop =========
-    for (int n = 0; n < numSamples; n++) {
+    //Render the string into the mono scratch block first, then envelope and mix
+    //it as whole-block operations
+    while (numSamples > 0 && isVoiceActive())
+    {
+        int chunk = juce::jmin(numSamples, scratchSize);
 
-        // Shift left-going wave safely
-        if (L > 1 && Left.size() >= static_cast<size_t>(L))
-        {
-            for (int i = 0; i < L - 1; ++i)
-                Left[i] = Left[i + 1];
+        if (hasVibrato())
+            chunk = juce::jmin(chunk, vibratoBlockSize);
 
-            Left[L - 1] = 0.0f; // append dummy value
-        }
+        updateStringParameters(chunk);
 
-        //At the 'nut' (left - hand end), assume perfect reflection(*-1).
-        //New right - going value is negative of new value at nut of left - going
-        float nut = -Left[0];
+        if (modal)
+        {
+            //The mode bank is float only; widen its output for a double host
+            if constexpr (std::is_same_v<SampleType, float>)
+            {
+                modes.process(output, chunk);
+            }
+            else
+            {
+                float* modeOutput = floatPath.output.get();
+                modes.process(modeOutput, chunk);
+
+                for (int n = 0; n < chunk; n++)
+                    output[n] = (SampleType)modeOutput[n];
+            }
+        }
+        else if (oversampling == 1)
+        {
+            path.string.process(output, chunk);
+        }
+        else
+        {
+            //Run the string at the higher rate, then 2:1 per stage back down
+            SampleType* os = path.oversampled.get();
+            path.string.process(os, chunk * oversampling);
+
+            if (oversampling == 4)
+            {
+                path.decimators[0].process(os, os, chunk * 2);
+                path.decimators[1].process(os, output, chunk);
+            }
+            else
+            {
+                path.decimators[0].process(os, output, chunk);
+            }
+        }
 
-        //Add reflection from nut into first element of right - going delay line;
-        //Shift right - going wave one step
-        for (int i = L - 1; i > 0; i--)
-            Right[i] = Right[i - 1];
+        mixString(output, outputBuffer, startSample, chunk);
 
-        Right[0] = nut;  // prepend nut value
+        startSample += chunk;
+        numSamples -= chunk;
+    }
+}
 
-        //At the 'bridge' (right - hand end), assume perfect reflection(*-1).
-        //New left - going value is negative of new value at bridge of right - going
-        float bridge = -r * Right[L - 1];
+void SynthVoice::renderFromString(const float* stringOutput, AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    mixString(stringOutput, outputBuffer, startSample, numSamples);
+}
 
-        //Add new bridge value to end of left - going delay line, replacing dummy
-        //value from above :
-        Left[L - 1] = bridge;
+void SynthVoice::renderFromString(const double* stringOutput, AudioBuffer<double>& outputBuffer, int startSample, int numSamples)
+{
+    mixString(stringOutput, outputBuffer, startSample, numSamples);
+}
 
-        //Moving Average Filter(3 Point)
-        /*
-        for (int i = 1; i < L - 1; ++i)
-            Left[i] = (Left[i - 1] + Left[i] + Left[i + 1]) / 3.0f;
-        */
+template <typename SampleType>
+void SynthVoice::mixString(const SampleType* stringOutput, AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples)
+{
+    auto& path = getPath<SampleType>();
 
-        //Biquad Filter 
-        filter.setLowPass(15000, 0.71);
+    while (numSamples > 0)
+    {
+        const int chunk = juce::jmin(numSamples, scratchSize);
+        SampleType* mono = path.mono.get();
+        SampleType* env = path.envelope.get();
 
-        for (int i = 1; i < L - 1; ++i)
-            Left[i] = filter.tick(Left[i]);
-            
-        //Output is sum of left and right going delay lines at pickup point.
-        // Calculate output :
-        float OutSample = Left[pickup] + Right[pickup];
+        //The ADSR itself is float; the envelope path runs at SampleType from here
+        for (int n = 0; n < chunk; n++)
+            env[n] = (SampleType)MainADSR.getNextSample();
 
-        float MainADSRenv = MainADSR.getNextSample(); 
-        float finalSample = OutSample * MainADSRenv * level; 
+        // velocity level and envelope as block multiplies
+        juce::FloatVectorOperations::multiply(mono, stringOutput, (SampleType)level, chunk);
+        juce::FloatVectorOperations::multiply(mono, env, chunk);
 
         // write into all channels
         for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
-            outputBuffer.addSample(channel, startSample + n, finalSample);
+            juce::FloatVectorOperations::add(outputBuffer.getWritePointer(channel, startSample), mono, chunk);
+
+        lastEnvelope = (float)env[chunk - 1];
+        samplesSinceNoteOn += chunk;
+
+        stringOutput += chunk;
+        startSample += chunk;
+        numSamples -= chunk;
     }
-    ++startSample;
 
     if (!MainADSR.isActive())
         clearCurrentNote();
+    else
+        retireIfDecayed();
+}
+
+void SynthVoice::updateStringParameters(int numSamples)
+{
+    //The mode bank's decays and pitch are fixed at note-on
+    if (modal)
+        return;
+
+    const auto& params = synth->getParameterSnapshot();
+
+    //Pitch bend and vibrato: the bridge read position moves to where this chunk
+    //ends up, ramped per sample (with vibrato on, chunks are vibratoBlockSize at
+    //most, so it's piecewise linear over that many samples)
+    vibratoPhase = std::fmod(vibratoPhase + MathConstants<double>::twoPi * params.VibratoRate * numSamples / SampleRate,
+                             MathConstants<double>::twoPi);
+
+    const float ratio = getPitchRatio(params);
+    const float readOffset = getReadOffsetFor(ratio);
+    withString([&](auto& string) { string.setReadOffset(readOffset, numSamples * oversampling); });
+    periodInSamples = basePeriod / ratio;
+
+    smoothedBRC.setTargetValue(params.BridgeRefCoeff);
+    smoothedCutoff.setTargetValue(params.LossCutoff);
+
+    if (!smoothedBRC.isSmoothing() && !smoothedCutoff.isSmoothing())
+        return;
+
+    //Ramp to wherever the smoothers will be at the end of this chunk; the loss
+    //type stays as picked at note-on, only its cutoff moves
+    r = smoothedBRC.skip(numSamples);
+    const float cutoff = smoothedCutoff.skip(numSamples);
+
+    withString([&](auto& string)
+    {
+        typename std::decay_t<decltype(string)>::Filter target;
+        target.design(string.getLossFilter().type, SampleRate * oversampling, cutoff);
+
+        string.rampTo(r, target, numSamples * oversampling);
+    });
+}
+
+void SynthVoice::retireIfDecayed()
+{
+    if (modal)
+    {
+        //Modes below the floor are dropped as they go, the voice with the last one
+        modes.cullBelow(retireGain / juce::jmax(level, 1.0e-6f));
+
+        if (modes.isActive())
+            return;
+
+        MainADSR.reset();
+        clearCurrentNote();
+        return;
+    }
+
+    //Running energy is cheap to check, only recount exactly when it says we're done
+    const bool decayed = withString([this](auto& string)
+    {
+        if (string.getRmsAmplitude() * level >= retireGain)
+            return false;
+
+        string.resyncEnergy();
+
+        if (string.getRmsAmplitude() * level >= retireGain)
+            return false;
+
+        string.clear();
+        return true;
+    });
+
+    if (!decayed)
+        return;
+
+    MainADSR.reset();
+    L = 0;
+    clearCurrentNote();
 }
 //===============================================================================
 void SynthVoice::releaseResources()
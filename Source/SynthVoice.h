@@ -2,14 +2,37 @@
 
 #include <JuceHeader.h>
 #include "SynthSound.h"
+#include "Waveguide.h"
+#include "HalfBandDecimator.h"
+#include "ModalResonator.h"
+#include "Excitation.h"
 
 using namespace juce;
 
 //===============================================================================
-struct ChainSettings
+enum class VoiceModel
+{
+    Waveguide = 0,
+    Modal               // damped resonator bank, for stiff/inharmonic timbres
+};
+
+//===============================================================================
+// Parameter snapshot, published by the processor once per block. Kept on its
+// own cache line so voices reading it never share a line with anything written
+// during the block.
+struct alignas(64) ChainSettings
 {
     float Attack{ 0.0f }, Decay{ 0.0f }, Sustain{ 0.0f }, Release{ 0.0f };
     float PluckPos{ 0.0f }, BridgeRefCoeff{ 0.0f };
+    LossFilterType LossType{ LossFilterType::BiQuad };
+    ExcitationType Excitation{ ExcitationType::Pluck };
+    float LossCutoff{ LossFilter<float>::defaultCutoff };
+    float RetireThresholdDb{ -110.0f };
+    float PitchBendRange{ 2.0f }, VibratoDepth{ 0.0f }, VibratoRate{ 5.5f };
+    bool AdaptiveQuality{ false };
+    VoiceModel Model{ VoiceModel::Waveguide };
+    float BridgeCoupling{ 0.0f };
+    float Inharmonicity{ 0.0f };
 };
 
 //===============================================================================
@@ -25,18 +48,95 @@ public:
     void startNote(int midiNoteNumber, float velocity, SynthesiserSound* sound, int currentPitchWheelPosition) override;
     void stopNote(float velocity, bool allowTailOff) override;
     void renderNextBlock(AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override;
+    void renderNextBlock(AudioBuffer<double>& outputBuffer, int startSample, int numSamples) override;
+
+    // Envelope and mix for string output already rendered by the StringBank (or,
+    // for double strings, the synthesiser's coupled bridge loop)
+    void renderFromString(const float* stringOutput, AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
+    void renderFromString(const double* stringOutput, AudioBuffer<double>& outputBuffer, int startSample, int numSamples);
+
+    // Follows BRC and loss cutoff from the current snapshot, ramping the string
+    // over the next numSamples. Call before rendering each chunk.
+    void updateStringParameters(int numSamples);
 
     void pitchWheelMoved(int newPitchWheelValue) override;
     void controllerMoved(int controllerNumber, int newControllerValue) override;
 
+    //Mod wheel (0..1) per MIDI channel; kept by every voice so a note started
+    //later still knows where the wheel is on its channel
+    void setModWheel(int channel, float value) noexcept;
+
     void setADSR(float attack, float decay, float sustain, float release);
-    void prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels);
+    //useDoublePrecision picks which string path the voice runs; the synthesiser
+    //then hands it rails of that type
+    void prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels, bool useDoublePrecision = false);
     void releaseResources();
 
-    std::vector<float> createPluckShape(float pluck, int L);
+    void setDelayLineStorage(float* leftRail, float* rightRail, int railCapacity);
+    void setDelayLineStorage(double* leftRail, double* rightRail, int railCapacity);
+    void moveDelayLineStorage(float* leftRail, float* rightRail, int railCapacity);
+    void moveDelayLineStorage(double* leftRail, double* rightRail, int railCapacity);
+
+    //The float string, which is what the StringBank lanes load and store
+    WaveguideString<float>& getString() noexcept { return floatPath.string; }
+    const WaveguideString<float>& getString() const noexcept { return floatPath.string; }
+
+    //The double string and a scratch block for its output, for coupled rendering
+    WaveguideString<double>& getPreciseString() noexcept { return doublePath.string; }
+    double* getPreciseOutput() noexcept { return doublePath.output.get(); }
+
+    bool isDoublePrecision() const noexcept { return doublePrecision; }
+
+    //Voice stealing inputs
+    float getStealEnergy() const noexcept { return lastEnvelope * level * getRmsAmplitude(); }
+    double getSecondsSinceNoteOn() const noexcept { return (double)samplesSinceNoteOn / SampleRate; }
+    float getRenderCost() const noexcept { return modal ? getModalRenderCostFor(modes.getNumModes()) : (float)oversampling * getRenderCostFor(L); }
+
+    //What getRenderCost() would come to if this voice started the note now, with
+    //the current voice model, adaptive oversampling and mode count
+    float getRenderCostForNote(int midiNoteNumber) const;
+
+    //Relative cost of one string; the per-sample work is fixed but the rails'
+    //cache footprint grows with L
+    static float getRenderCostFor(int length) noexcept { return 1.0f + (float)length / 4096.0f; }
+
+    //A mode is a couple of multiplies per sample in a vector lane, so a string
+    //costs roughly as much as a few dozen of them
+    static float getModalRenderCostFor(int numModes) noexcept { return (float)numModes / 32.0f; }
+
+    //Note-on for the modal voice model
+    void startModes();
 
     bool isMakingSound() const noexcept { return MainADSR.isActive(); }
 
+    //Velocity gain applied to the string output
+    float getLevel() const noexcept { return level; }
+
+    //String period at the output rate, for the scope trigger
+    float getPeriodInSamples() const noexcept { return periodInSamples; }
+
+    //Internal rate multiple of the string. Only 1 can go through the StringBank,
+    //oversampled voices render themselves
+    int getOversampling() const noexcept { return oversampling; }
+
+    //Vibrato is re-evaluated at least this often; callers split their chunks to match
+    static constexpr int vibratoBlockSize = 32;
+    bool hasVibrato() const noexcept;
+
+    //Plain waveguide strings at 1x take part in bridge coupling; oversampled, modal
+    //and dispersive voices render themselves
+    bool couplesAtBridge() const noexcept { return !modal && oversampling == 1 && !(doublePrecision ? doublePath.string.hasDispersion() : floatPath.string.hasDispersion()); }
+
+    //The float ones go through the StringBank lanes
+    bool rendersThroughBank() const noexcept { return !doublePrecision && couplesAtBridge(); }
+
+    //String (or mode bank) still has something ringing in it
+    bool isResonating() const noexcept { return modal ? modes.isActive() : (doublePrecision ? doublePath.string.isActive() : floatPath.string.isActive()); }
+    float getRmsAmplitude() const noexcept { return modal ? modes.getRmsAmplitude() : (doublePrecision ? doublePath.string.getRmsAmplitude() : floatPath.string.getRmsAmplitude()); }
+
+    //Frees the voice once the string itself has decayed below the retire threshold
+    void retireIfDecayed();
+
 private:
     Physical_Model_StringAudioProcessor* synth = nullptr;
 
@@ -51,16 +151,99 @@ private:
     float r = 0.94f;          
     float Out = 0.0f;
 
+    //Live string parameters, smoothed so automation doesn't zipper
+    juce::SmoothedValue<float> smoothedBRC;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> smoothedCutoff;
+    static constexpr double parameterRampSeconds = 0.02;
+
+    float lastEnvelope = 0.0f;
+    float retireGain = 0.0f;
+    int64 samplesSinceNoteOn = 0;
+
     int L = 0;               
     int pickup = 0;           
     int pluck = 0;      
 
-    std::vector<float> Left, Right, x;
+    //Adaptive quality: short strings run at 2x/4x so the tuning allpass and the
+    //loss filter stay accurate over their harmonics, then come back down
+    //through half-band decimators
+    static constexpr int maxOversampling = 4;
+    static constexpr double minAdaptiveLength = 96.0;
+    static int getOversamplingFor(double exactLength, bool adaptive) noexcept;
+
+    int oversampling = 1;
+    float periodInSamples = 0.0f;
+
+    //String, decimators and scratch at one sample type. Only the path matching
+    //the prepared precision gets rails; the float scratch is always there since
+    //the mode bank renders in float
+    template <typename SampleType>
+    struct StringPath
+    {
+        WaveguideString<SampleType> string;
+        HalfBandDecimator<SampleType> decimators[2];
+        HeapBlock<SampleType> output, envelope, mono, oversampled;
+    };
+
+    StringPath<float> floatPath;
+    StringPath<double> doublePath;
+    bool doublePrecision = false;
+
+    template <typename SampleType>
+    StringPath<SampleType>& getPath() noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doublePath;
+        else
+            return floatPath;
+    }
+
+    //Calls function with whichever string is live
+    template <typename Function>
+    decltype(auto) withString(Function&& function) { return doublePrecision ? function(doublePath.string) : function(floatPath.string); }
+
+    template <typename SampleType>
+    void allocateScratch(StringPath<SampleType>& path);
+
+    template <typename SampleType>
+    void assignStorage(SampleType* leftRail, SampleType* rightRail, int railCapacity);
+
+    template <typename SampleType>
+    void moveStorage(SampleType* leftRail, SampleType* rightRail, int railCapacity);
+
+    //Waveguide half of startNote, on the live path
+    template <typename SampleType>
+    void startString(StringPath<SampleType>& path);
+
+    template <typename SampleType>
+    void renderVoice(AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples);
+
+    template <typename SampleType>
+    void mixString(const SampleType* stringOutput, AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples);
+
+    //Pitch modulation: bend (per channel, so MPE gives per-note pitch) and mod
+    //wheel vibrato move the string's fractional bridge read position around the
+    //note's loop delay; nothing is reallocated or restarted
+    float getPitchRatio(const ChainSettings& params) const noexcept;
+    float getReadOffsetFor(float ratio) const noexcept;
+
+    int midiChannel = 1;
+    int pitchWheel = 8192;
+    std::array<float, 17> modWheel{};
+    double vibratoPhase = 0.0;
+    double baseLoopDelay = 0.0;
+    float basePeriod = 0.0f;
+    float maxReadOffset = 0.0f;
+    float restReadOffset = 0.0f;    //Nonzero when L was shortened to leave room for upward bends
+
+    //Modal voice model, picked per note; while it's in use the string stays cleared
+    ModalResonator modes;
+    bool modal = false;
+
+    int scratchSize = 0;
 
     bool ismakingsound;
 
-    stk::BiQuad filter;
-
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthVoice)
 };
 
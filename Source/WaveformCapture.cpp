@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    WaveformCapture.cpp
+    Created: 17 Oct 2026 2:48:05pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "WaveformCapture.h"
+
+//===============================================================================
+WaveformCapture::WaveformCapture()
+{
+    static_assert(ringSize >= ((int64)1 << (levelShift * numLevels)), "ring must hold at least one top level bucket");
+
+    ring.allocate((size_t)ringSize, true);
+
+    for (int level = 0; level < numLevels; level++)
+    {
+        auto& l = levels[(size_t)level];
+        const auto numBuckets = ringSize >> getBucketShift(level);
+
+        l.mins.allocate((size_t)numBuckets, true);
+        l.maxs.allocate((size_t)numBuckets, true);
+        l.mask = numBuckets - 1;
+    }
+}
+
+void WaveformCapture::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate, std::memory_order_relaxed);
+
+    // A reader still looking at old positions only ever sees zeros or old samples
+    FloatVectorOperations::clear(ring.get(), (int)ringSize);
+
+    for (int level = 0; level < numLevels; level++)
+    {
+        auto& l = levels[(size_t)level];
+        const auto numBuckets = (int)(ringSize >> getBucketShift(level));
+
+        FloatVectorOperations::clear(l.mins.get(), numBuckets);
+        FloatVectorOperations::clear(l.maxs.get(), numBuckets);
+        l.pendingMin = l.pendingMax = 0.0f;
+    }
+
+    writerPosition = 0;
+    writePosition.store(0);
+    period.store(0.0f);
+}
+
+void WaveformCapture::pushBlock(const float* samples, int numSamples, float periodInSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    // Bulk copy into the ring, split at most once at the wrap
+    const int start = (int)(writerPosition & ringMask);
+    const int firstPart = jmin(numSamples, (int)(ringSize - start));
+
+    FloatVectorOperations::copy(ring.get() + start, samples, firstPart);
+
+    if (numSamples > firstPart)
+        FloatVectorOperations::copy(ring.get(), samples + firstPart, numSamples - firstPart);
+
+    // Fold the block into the finest level a bucket's worth at a time;
+    // completed buckets cascade upwards
+    const int bucketSize = 1 << getBucketShift(0);
+    auto& finest = levels[0];
+    int64 position = writerPosition;
+
+    for (int i = 0; i < numSamples;)
+    {
+        const int offset = (int)(position & (bucketSize - 1));
+        const int count = jmin(numSamples - i, bucketSize - offset);
+        const auto range = FloatVectorOperations::findMinAndMax(samples + i, count);
+
+        if (offset == 0)
+        {
+            finest.pendingMin = range.getStart();
+            finest.pendingMax = range.getEnd();
+        }
+        else
+        {
+            finest.pendingMin = jmin(finest.pendingMin, range.getStart());
+            finest.pendingMax = jmax(finest.pendingMax, range.getEnd());
+        }
+
+        i += count;
+        position += count;
+
+        if ((position & (bucketSize - 1)) == 0)
+            completeBucket(0, (position >> getBucketShift(0)) - 1);
+    }
+
+    writerPosition = position;
+
+    period.store(periodInSamples, std::memory_order_relaxed);
+    writePosition.store(writerPosition, std::memory_order_release);
+}
+
+void WaveformCapture::completeBucket(int level, int64 bucketIndex) noexcept
+{
+    auto& l = levels[(size_t)level];
+
+    l.mins[(size_t)(bucketIndex & l.mask)] = l.pendingMin;
+    l.maxs[(size_t)(bucketIndex & l.mask)] = l.pendingMax;
+
+    if (level + 1 >= numLevels)
+        return;
+
+    auto& parent = levels[(size_t)level + 1];
+    const int64 childrenPerParent = 1 << levelShift;
+    const bool firstChild = (bucketIndex & (childrenPerParent - 1)) == 0;
+
+    parent.pendingMin = firstChild ? l.pendingMin : jmin(parent.pendingMin, l.pendingMin);
+    parent.pendingMax = firstChild ? l.pendingMax : jmax(parent.pendingMax, l.pendingMax);
+
+    if ((bucketIndex & (childrenPerParent - 1)) == childrenPerParent - 1)
+        completeBucket(level + 1, bucketIndex >> levelShift);
+}
+
+//===============================================================================
+int64 WaveformCapture::getOldestReadablePosition() const noexcept
+{
+    // A quarter of the ring is left as headroom against the writer lapping us
+    return jmax((int64)0, getWritePosition() - (ringSize - ringSize / 4));
+}
+
+int64 WaveformCapture::findTrigger(int64 endPosition, int searchLength) const noexcept
+{
+    const int64 oldest = jmax(getOldestReadablePosition() + 1, endPosition - searchLength);
+
+    for (int64 i = endPosition - 1; i >= oldest; --i)
+        if (getSample(i - 1) < 0.0f && getSample(i) >= 0.0f)
+            return i;
+
+    return endPosition;
+}
+
+void WaveformCapture::accumulate(int level, int64 start, int64 end, float& lo, float& hi) const noexcept
+{
+    if (start >= end)
+        return;
+
+    if (level < 0)
+    {
+        for (int64 i = start; i < end; ++i)
+        {
+            const float s = getSample(i);
+            lo = jmin(lo, s);
+            hi = jmax(hi, s);
+        }
+
+        return;
+    }
+
+    const int shift = getBucketShift(level);
+    const int64 size = (int64)1 << shift;
+    const int64 firstFull = (start + size - 1) & ~(size - 1);
+    const int64 lastFull = end & ~(size - 1);
+
+    if (firstFull >= lastFull)
+    {
+        accumulate(level - 1, start, end, lo, hi);
+        return;
+    }
+
+    // Ragged edges from the finer levels, whole buckets from this one
+    accumulate(level - 1, start, firstFull, lo, hi);
+
+    const auto& l = levels[(size_t)level];
+
+    for (int64 b = firstFull >> shift; b < lastFull >> shift; ++b)
+    {
+        lo = jmin(lo, l.mins[(size_t)(b & l.mask)]);
+        hi = jmax(hi, l.maxs[(size_t)(b & l.mask)]);
+    }
+
+    accumulate(level - 1, lastFull, end, lo, hi);
+}
+
+float WaveformCapture::getRecentPeak(int numSamples) const noexcept
+{
+    const int64 end = getWritePosition();
+    const int64 start = jmax(getOldestReadablePosition(), end - numSamples);
+
+    if (start >= end)
+        return 0.0f;
+
+    float lo = 0.0f, hi = 0.0f;
+    getMinMax(start, end, 1, &lo, &hi);
+
+    return jmax(std::abs(lo), std::abs(hi));
+}
+
+void WaveformCapture::getMinMax(int64 startPosition, int64 endPosition, int numPixels, float* mins, float* maxs) const noexcept
+{
+    const double samplesPerPixel = (double)(endPosition - startPosition) / (double)jmax(1, numPixels);
+
+    // Coarsest level whose buckets still fit inside one pixel
+    int topLevel = -1;
+
+    while (topLevel + 1 < numLevels && (double)((int64)1 << getBucketShift(topLevel + 1)) <= samplesPerPixel)
+        ++topLevel;
+
+    for (int x = 0; x < numPixels; ++x)
+    {
+        const int64 s = startPosition + (int64)std::floor(x * samplesPerPixel);
+        const int64 e = jmax(s + 1, startPosition + (int64)std::floor((x + 1) * samplesPerPixel));
+
+        float lo = std::numeric_limits<float>::max();
+        float hi = std::numeric_limits<float>::lowest();
+
+        accumulate(topLevel, s, e, lo, hi);
+
+        mins[x] = lo;
+        maxs[x] = hi;
+    }
+}
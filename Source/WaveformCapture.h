@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    WaveformCapture.h
+    Created: 17 Oct 2026 2:48:05pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// Output capture for the scope.
+//
+// The audio thread does one bulk copy per block into a ring holding a few
+// seconds of audio, folds the block into a min/max pyramid (buckets of 16, 256
+// and 4096 samples) and then publishes the new write position with a single
+// atomic store. The editor asks for min/max per pixel over any span; each pixel
+// is answered from the coarsest complete buckets that fit, so drawing costs
+// O(pixels) whether it shows one string period or several seconds.
+//
+// The ring and pyramid are allocated once, at construction, and never change
+// size, so the editor can keep reading while prepare() runs for a new rate.
+//===============================================================================
+class WaveformCapture
+{
+public:
+    static constexpr int numLevels = 3;
+    static constexpr int levelShift = 4;   // each level is 16x coarser than the one below
+    // About four seconds at 192kHz, longer at lower rates
+    static constexpr int64 ringSize = (int64)1 << 20;
+    static constexpr int64 ringMask = ringSize - 1;
+
+    WaveformCapture();
+
+    // Not for the audio thread, clears the ring and pyramid
+    void prepare(double sampleRate);
+
+    // Audio thread. periodInSamples is the fundamental of the newest held note
+    // (0 when nothing is sounding), used for pitch-synchronous triggering.
+    void pushBlock(const float* samples, int numSamples, float periodInSamples) noexcept;
+
+    //===============================================================================
+    // Reader side (message thread)
+    int64 getWritePosition() const noexcept { return writePosition.load(std::memory_order_acquire); }
+    float getPeriodInSamples() const noexcept { return period.load(std::memory_order_relaxed); }
+    double getSampleRate() const noexcept { return sampleRate.load(std::memory_order_relaxed); }
+
+    // Oldest position still safely readable, leaving headroom for blocks written meanwhile
+    int64 getOldestReadablePosition() const noexcept;
+
+    // Latest rising zero crossing at or before endPosition, searched back at
+    // most searchLength samples; endPosition if there isn't one
+    int64 findTrigger(int64 endPosition, int searchLength) const noexcept;
+
+    // Min and max for each of numPixels equal slices of [startPosition, endPosition)
+    void getMinMax(int64 startPosition, int64 endPosition, int numPixels, float* mins, float* maxs) const noexcept;
+
+    // Largest absolute sample in the last numSamples written
+    float getRecentPeak(int numSamples) const noexcept;
+
+    // One raw sample, for spans short enough to draw as a line
+    float getSample(int64 position) const noexcept { return ring[(size_t)(position & ringMask)]; }
+
+private:
+    struct Level
+    {
+        HeapBlock<float> mins, maxs;
+        int64 mask = 0;
+        float pendingMin = 0.0f, pendingMax = 0.0f;
+    };
+
+    static int getBucketShift(int level) noexcept { return levelShift * (level + 1); }
+
+    void completeBucket(int level, int64 bucketIndex) noexcept;
+    void accumulate(int level, int64 start, int64 end, float& lo, float& hi) const noexcept;
+
+    HeapBlock<float> ring;
+    std::array<Level, numLevels> levels;
+
+    int64 writerPosition = 0;   // audio thread's own copy
+    std::atomic<int64> writePosition{ 0 };
+    std::atomic<float> period{ 0.0f };
+
+    std::atomic<double> sampleRate{ 44100.0 };
+};
@@ -0,0 +1,351 @@
+/*
+  ==============================================================================
+
+    Waveguide.cpp
+    Created: 16 Oct 2026 8:45:02pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#include "Waveguide.h"
+#include <complex>
+
+//===============================================================================
+template <typename SampleType>
+void LossFilter<SampleType>::design(LossFilterType type, double sampleRate, float cutoff, float Q)
+{
+    // Keep the design below Nyquist whatever the sample rate
+    const double fc = juce::jmin((double)cutoff, sampleRate * 0.45);
+
+    this->type = type;
+    dispersion = 0;
+
+    switch (type)
+    {
+    case LossFilterType::MovingAverage:
+        b0 = b1 = b2 = SampleType(1) / SampleType(3);
+        a1 = a2 = 0;
+        break;
+
+    case LossFilterType::OnePole:
+    {
+        const double p = std::exp(-juce::MathConstants<double>::twoPi * fc / sampleRate);
+        b0 = (SampleType)(1.0 - p);
+        b1 = b2 = 0;
+        a1 = (SampleType)-p;
+        a2 = 0;
+        break;
+    }
+
+    case LossFilterType::BiQuad:
+    case LossFilterType::AllpassDispersion:
+    default:
+    {
+        const double K = std::tan(juce::MathConstants<double>::pi * fc / sampleRate);
+        const double kSqr = K * K;
+        const double denom = 1.0 + K / Q + kSqr;
+
+        b0 = (SampleType)(kSqr / denom);
+        b1 = SampleType(2) * b0;
+        b2 = b0;
+        a1 = (SampleType)(2.0 * (kSqr - 1.0) / denom);
+        a2 = (SampleType)((1.0 - K / Q + kSqr) / denom);
+        break;
+    }
+    }
+}
+
+template <typename SampleType>
+double LossFilter<SampleType>::getPhaseDelay(double w) const noexcept
+{
+    if (w <= 0.0)
+        return 0.0;
+
+    const std::complex<double> z1inv = std::polar(1.0, -w);
+    const std::complex<double> z2inv = z1inv * z1inv;
+
+    const auto h = ((double)b0 + (double)b1 * z1inv + (double)b2 * z2inv)
+                 / (1.0 + (double)a1 * z1inv + (double)a2 * z2inv);
+
+    double delay = -std::arg(h) / w;
+
+    if (type == LossFilterType::AllpassDispersion)
+        delay += dispersionStages * getAllpassPhaseDelay((double)dispersion, w);
+
+    return delay;
+}
+
+template <typename SampleType>
+double LossFilter<SampleType>::getAllpassPhaseDelay(double coefficient, double w) noexcept
+{
+    if (w <= 0.0)
+        return (1.0 - coefficient) / (1.0 + coefficient);
+
+    const std::complex<double> z1inv = std::polar(1.0, -w);
+    return -std::arg((coefficient + z1inv) / (1.0 + coefficient * z1inv)) / w;
+}
+
+template <typename SampleType>
+void LossFilter<SampleType>::designDispersion(double inharmonicity, double w0)
+{
+    dispersion = 0;
+
+    if (type != LossFilterType::AllpassDispersion || inharmonicity <= 0.0 || w0 <= 0.0)
+        return;
+
+    // Matched between the fundamental and the highest of the first 8 partials
+    // below a quarter of the rate
+    auto stretch = [inharmonicity](int k) { return std::sqrt((1.0 + inharmonicity * k * k) / (1.0 + inharmonicity)); };
+
+    int partial = 8;
+
+    while (partial > 1 && partial * w0 * stretch(partial) >= juce::MathConstants<double>::halfPi)
+        --partial;
+
+    const double loop = juce::MathConstants<double>::twoPi / w0;
+    const double maxStageDelay = 0.5 * loop / dispersionStages;   // never more than half the loop
+
+    if (partial < 2 || maxStageDelay <= 1.0)
+        return;
+
+    // Partial k closes the loop when the loop delay at its frequency wk is
+    // 2 pi k / wk, so the cascade has to be this much longer at w0 than at wk
+    const double wk = partial * w0 * stretch(partial);
+    const double target = loop - juce::MathConstants<double>::twoPi * partial / wk;
+
+    // The spread grows monotonically as the coefficient goes towards -1
+    double lo = (1.0 - maxStageDelay) / (1.0 + maxStageDelay), hi = 0.0;
+
+    for (int i = 0; i < 40; ++i)
+    {
+        const double c = 0.5 * (lo + hi);
+        const double spread = dispersionStages * (getAllpassPhaseDelay(c, w0) - getAllpassPhaseDelay(c, wk));
+
+        if (spread > target)
+            lo = c;
+        else
+            hi = c;
+    }
+
+    dispersion = (SampleType)(0.5 * (lo + hi));
+}
+
+//===============================================================================
+template <typename SampleType>
+void WaveguideString<SampleType>::setStorage(SampleType* leftRail, SampleType* rightRail, int railCapacity)
+{
+    jassert(juce::isPowerOfTwo(railCapacity));
+
+    Left = leftRail;
+    Right = rightRail;
+    capacity = railCapacity;
+    mask = capacity - 1;
+
+    clear();
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::releaseStorage() noexcept
+{
+    clear();
+
+    Left = Right = nullptr;
+    capacity = mask = 0;
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::relocate(SampleType* leftRail, SampleType* rightRail) noexcept
+{
+    if (L > 0 && Left != nullptr)
+    {
+        juce::FloatVectorOperations::copy(leftRail, Left, capacity);
+        juce::FloatVectorOperations::copy(rightRail, Right, capacity);
+    }
+
+    Left = leftRail;
+    Right = rightRail;
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::start(int length, int pickupIndex, SampleType reflectionCoeff)
+{
+    jassert(Left != nullptr && length <= capacity);
+
+    L = juce::jmin(length, capacity);
+    pickup = juce::jlimit(0, juce::jmax(0, L - 1), pickupIndex);
+    r = reflectionCoeff;
+
+    leftHead = rightHead = 0;
+    loss.reset();
+
+    ramping = false;
+    rStep = b0Step = b1Step = b2Step = a1Step = a2Step = 0;
+
+    tuned = false;
+    tuningCoeff = tuningState = 0;
+    selectRenderer();
+
+    readOffset = readOffsetStep = readOffsetTarget = 0;
+
+    // Excitation was written straight into the left rail, so only slots 0..L-1
+    // are touched; anything past L is stale and never read
+    juce::FloatVectorOperations::multiply(Left, SampleType(0.5), L);
+    juce::FloatVectorOperations::copy(Right, Left, L);
+
+    resyncEnergy();
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::resyncEnergy() noexcept
+{
+    double sum = 0.0;
+
+    for (int i = 0; i < L; ++i)
+    {
+        const double l = left(i), rr = right(i);
+        sum += l * l + rr * rr;
+    }
+
+    energy = sum;
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::clear()
+{
+    L = 0;
+    energy = 0.0;
+    leftHead = rightHead = 0;
+    loss.reset();
+    ramping = false;
+    rStep = b0Step = b1Step = b2Step = a1Step = a2Step = 0;
+    tuned = false;
+    tuningCoeff = tuningState = 0;
+    readOffset = readOffsetStep = readOffsetTarget = 0;
+    selectRenderer();
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::selectRenderer() noexcept
+{
+    static constexpr Renderer renderers[][2] =
+    {
+        { &WaveguideString::render<MovingAverageLoss, false>, &WaveguideString::render<MovingAverageLoss, true> },
+        { &WaveguideString::render<OnePoleLoss, false>,       &WaveguideString::render<OnePoleLoss, true> },
+        { &WaveguideString::render<BiQuadLoss, false>,        &WaveguideString::render<BiQuadLoss, true> },
+        { &WaveguideString::render<DispersionLoss, false>,    &WaveguideString::render<DispersionLoss, true> }
+    };
+
+    const int type = juce::jlimit(0, (int)std::size(renderers) - 1, (int)loss.type);
+    renderer = renderers[type][tuned ? 1 : 0];
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::clearReadHistory(int extension) noexcept
+{
+    // Slots L.. of the right rail in logical order, wrapping at the end of the ring
+    const int count = juce::jlimit(0, juce::jmax(0, capacity - L), extension + 3);
+    const int first = (rightHead + L) & mask;
+    const int untilEnd = juce::jmin(count, capacity - first);
+
+    juce::FloatVectorOperations::clear(Right + first, untilEnd);
+    juce::FloatVectorOperations::clear(Right, count - untilEnd);
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::setReadOffset(SampleType offset, int numSamples) noexcept
+{
+    readOffsetTarget = clampReadOffset(offset);
+    readOffsetStep = (readOffsetTarget - readOffset) / (SampleType)juce::jmax(1, numSamples);
+}
+
+template <typename SampleType>
+double WaveguideString<SampleType>::getTuningCoefficient(double delay, double w) noexcept
+{
+    // H(z) = (c + z^-1) / (1 + c z^-1) has phase delay d at w when
+    // c = sin(w) / tan(w (d + 1) / 2) - cos(w); tends to (1 - d) / (1 + d) as w -> 0
+    const double c = std::sin(w) / std::tan(w * (delay + 1.0) * 0.5) - std::cos(w);
+    return juce::jlimit(-0.999, 0.999, c);
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::rampTo(SampleType targetR, const Filter& targetLoss, int numSamples) noexcept
+{
+    jassert(numSamples > 0);
+    const SampleType scale = SampleType(1) / (SampleType)juce::jmax(1, numSamples);
+
+    rTarget = targetR;
+    lossTarget = targetLoss;
+
+    rStep = (targetR - r) * scale;
+    b0Step = (targetLoss.b0 - loss.b0) * scale;
+    b1Step = (targetLoss.b1 - loss.b1) * scale;
+    b2Step = (targetLoss.b2 - loss.b2) * scale;
+    a1Step = (targetLoss.a1 - loss.a1) * scale;
+    a2Step = (targetLoss.a2 - loss.a2) * scale;
+
+    ramping = true;
+}
+
+template <typename SampleType>
+void WaveguideString<SampleType>::finishRamp() noexcept
+{
+    readOffset = readOffsetTarget;
+    readOffsetStep = 0;
+
+    if (!ramping)
+        return;
+
+    // Land exactly on the target so rounding in the increments never accumulates
+    r = rTarget;
+    loss.b0 = lossTarget.b0; loss.b1 = lossTarget.b1; loss.b2 = lossTarget.b2;
+    loss.a1 = lossTarget.a1; loss.a2 = lossTarget.a2;
+
+    rStep = b0Step = b1Step = b2Step = a1Step = a2Step = 0;
+    ramping = false;
+}
+
+//===============================================================================
+template <typename SampleType>
+int DelayLineArena<SampleType>::getRailCapacityFor(double sampleRate)
+{
+    const double lowest = MidiMessage::getMidiNoteInHertz(lowestMidiNote);
+    const int longestL = static_cast<int>(std::floor(sampleRate / lowest));
+
+    return juce::nextPowerOfTwo(juce::jmax(2, longestL));
+}
+
+template <typename SampleType>
+bool DelayLineArena<SampleType>::prepare(double sampleRate, int voices)
+{
+    const int newCapacity = getRailCapacityFor(sampleRate);
+
+    if (newCapacity == railCapacity && voices == numVoices && block != nullptr)
+        return false;
+
+    railCapacity = newCapacity;
+    numVoices = voices;
+
+    const size_t numSamples = (size_t)(2 * numVoices) * (size_t)railCapacity;
+    block.malloc(numSamples);
+
+    // Write every page now so the first note-on doesn't take the page faults
+    juce::FloatVectorOperations::clear(block.get(), (int)numSamples);
+
+    return true;
+}
+
+template <typename SampleType>
+void DelayLineArena<SampleType>::release()
+{
+    block.free();
+    railCapacity = numVoices = 0;
+}
+
+//===============================================================================
+template struct LossFilter<float>;
+template struct LossFilter<double>;
+template class WaveguideString<float>;
+template class WaveguideString<double>;
+template class DelayLineArena<float>;
+template class DelayLineArena<double>;
@@ -0,0 +1,456 @@
+/*
+  ==============================================================================
+
+    Waveguide.h
+    Created: 16 Oct 2026 8:45:02pm
+    Author:  josep
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+//===============================================================================
+// The string path is templated on sample type. float is what the lockstep bank
+// and single precision hosts run; double is for hosts that process in double,
+// and keeps very long, nearly lossless strings (BRC close to +-1) from piling
+// up rounding error round the loop. Both are instantiated in Waveguide.cpp.
+//===============================================================================
+
+//===============================================================================
+// Lumped loss/damping filter applied once per sample at the bridge junction.
+// Every variant is held as biquad coefficients, so the StringBank can run lanes
+// with different filters in one vector; the designs only run at note-on.
+//===============================================================================
+enum class LossFilterType
+{
+    MovingAverage = 0,  // 3 point moving average (steel pan-ish)
+    OnePole,
+    BiQuad,             // same low pass design as stk::BiQuad::setLowPass
+    AllpassDispersion   // biquad then an allpass cascade that stretches the partials (stiff strings)
+};
+
+template <typename SampleType>
+struct LossFilter
+{
+    static constexpr float defaultCutoff = 15000.0f;
+    static constexpr float defaultQ = 0.71f;
+    static constexpr int dispersionStages = 4;
+
+    void design(LossFilterType type, double sampleRate, float cutoff = defaultCutoff, float Q = defaultQ);
+    void reset() noexcept { z1 = z2 = SampleType(0); dispersionState.fill(SampleType(0)); }
+
+    // AllpassDispersion only: sets the cascade so mode k of a loop whose fundamental
+    // is w0 = 2 pi / loop delay lands near k w0 sqrt(1 + B k^2) / sqrt(1 + B). Call
+    // after design()
+    void designDispersion(double inharmonicity, double w0);
+
+    // Phase delay in samples at normalised angular frequency w (radians/sample),
+    // including the dispersion cascade
+    double getPhaseDelay(double w) const noexcept;
+
+    // Of one first order allpass (c + z^-1) / (1 + c z^-1)
+    static double getAllpassPhaseDelay(double coefficient, double w) noexcept;
+
+    // Transposed direct form II
+    inline SampleType process(SampleType in) noexcept
+    {
+        const SampleType out = b0 * in + z1;
+        z1 = b1 * in - a1 * out + z2;
+        z2 = b2 * in - a2 * out;
+        return out;
+    }
+
+    SampleType b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    SampleType z1 = 0, z2 = 0;
+
+    LossFilterType type = LossFilterType::BiQuad;
+    SampleType dispersion = 0;
+    std::array<SampleType, dispersionStages> dispersionState{};
+};
+
+//===============================================================================
+// Loss filter policies for WaveguideString's render loops. Each one runs only
+// the arithmetic its design needs (the coefficients it skips are zero for it),
+// so the loop a string runs has no switch on the filter type in it. The
+// StringBank keeps the full biquad for every lane instead.
+//===============================================================================
+struct MovingAverageLoss
+{
+    template <typename SampleType>
+    static SampleType process(LossFilter<SampleType>& f, SampleType in) noexcept
+    {
+        const SampleType out = f.b0 * in + f.z1;
+        f.z1 = f.b1 * in + f.z2;
+        f.z2 = f.b2 * in;
+        return out;
+    }
+};
+
+struct OnePoleLoss
+{
+    template <typename SampleType>
+    static SampleType process(LossFilter<SampleType>& f, SampleType in) noexcept
+    {
+        const SampleType out = f.b0 * in + f.z1;
+        f.z1 = -f.a1 * out;
+        return out;
+    }
+};
+
+struct BiQuadLoss
+{
+    template <typename SampleType>
+    static SampleType process(LossFilter<SampleType>& f, SampleType in) noexcept { return f.process(in); }
+};
+
+struct DispersionLoss
+{
+    template <typename SampleType>
+    static SampleType process(LossFilter<SampleType>& f, SampleType in) noexcept
+    {
+        SampleType y = f.process(in);
+
+        for (auto& state : f.dispersionState)
+        {
+            const SampleType out = f.dispersion * y + state;
+            state = y - f.dispersion * out;
+            y = out;
+        }
+
+        return y;
+    }
+};
+
+//===============================================================================
+// Two-rail digital waveguide string.
+//
+// Both travelling waves live in ring buffers, so moving them along the string
+// is a head pointer step rather than a copy of every element. Logical index i
+// of a rail (0 = nut, L-1 = bridge) maps to physical slot (head + i) & mask.
+//===============================================================================
+template <typename SampleType>
+class WaveguideString
+{
+public:
+    using Filter = LossFilter<SampleType>;
+
+    WaveguideString() = default;
+
+    // Rails are owned by the DelayLineArena; capacity must be a power of two
+    void setStorage(SampleType* leftRail, SampleType* rightRail, int railCapacity);
+
+    // Drops the rails (their arena is being freed); the string is silent until
+    // setStorage is called again
+    void releaseStorage() noexcept;
+
+    // Moves to new rails of the same capacity keeping whatever is ringing
+    void relocate(SampleType* leftRail, SampleType* rightRail) noexcept;
+    int getCapacity() const noexcept { return capacity; }
+
+    // Excitation is written here (logical 0..L-1) before start() is called
+    SampleType* getExcitationBuffer() noexcept { return Left; }
+
+    // Splits the excitation half into each rail and resets the heads. Never allocates.
+    void start(int length, int pickupIndex, SampleType reflectionCoeff);
+    void setLossFilter(LossFilterType type, double sampleRate, float cutoff = Filter::defaultCutoff)
+    {
+        loss.design(type, sampleRate, cutoff);
+        selectRenderer();
+    }
+
+    // Stiffness for the AllpassDispersion filter, see LossFilter::designDispersion
+    void setDispersion(double inharmonicity, double w0) { loss.designDispersion(inharmonicity, w0); }
+    bool hasDispersion() const noexcept { return loss.type == LossFilterType::AllpassDispersion; }
+
+    void clear();
+
+    // Linear per-sample ramp of r and the loss coefficients, reaching the target
+    // after exactly numSamples (the next process() call or bank chunk). Linear
+    // interpolation between two stable low pass designs stays stable.
+    void rampTo(SampleType targetR, const Filter& targetLoss, int numSamples) noexcept;
+    void finishRamp() noexcept;
+    bool isRamping() const noexcept { return ramping; }
+
+    // Fine tuning: a first order allpass after the loss filter adds a fractional
+    // delay to the loop. Set after start(), which switches it off again.
+    void setTuning(double allpassCoefficient) noexcept { tuningCoeff = (SampleType)allpassCoefficient; tuned = true; selectRenderer(); }
+    bool isTuned() const noexcept { return tuned; }
+
+    // Pitch modulation: the bridge reads the right rail offset samples further
+    // along than L-1 (negative = shorter loop, higher pitch), through a cubic
+    // Lagrange interpolator, so the loop delay changes without touching L or the
+    // rails. setReadOffset ramps there over numSamples like rampTo; jumpReadOffset
+    // is for note-on. Offsets are clamped to what the rail holds.
+    void setReadOffset(SampleType offset, int numSamples) noexcept;
+    void jumpReadOffset(SampleType offset) noexcept { readOffset = readOffsetTarget = clampReadOffset(offset); readOffsetStep = 0; }
+    SampleType getReadOffset() const noexcept { return readOffset; }
+
+    // Zeroes the right rail past the bridge so a read offset of up to extension
+    // samples hears silence rather than whatever an old note left there
+    void clearReadHistory(int extension) noexcept;
+
+    // Allpass coefficient whose phase delay at w (radians/sample) is exactly delay samples
+    static double getTuningCoefficient(double delay, double w) noexcept;
+
+    // Loop delay in samples of a string of length L without tuning: both rails
+    // less the two reflection samples, plus the loss filter's delay at w
+    static double getLoopDelay(int length, const Filter& loss, double w) noexcept { return 2.0 * length - 2.0 + loss.getPhaseDelay(w); }
+
+    int getLength() const noexcept { return L; }
+    const Filter& getLossFilter() const noexcept { return loss; }
+    bool isActive() const noexcept { return L >= 2; }
+
+    SampleType& left(int i) noexcept { return Left[(leftHead + i) & mask]; }
+    SampleType& right(int i) noexcept { return Right[(rightHead + i) & mask]; }
+
+    // Sum of squares over both rails, kept up to date as samples enter and leave
+    double getEnergy() const noexcept { return energy; }
+    float getRmsAmplitude() const noexcept { return L > 0 ? (float)std::sqrt(juce::jmax(0.0, energy) / (double)L) : 0.0f; }
+
+    // Exact O(L) recount, to throw away accumulated rounding before a decision
+    void resyncEnergy() noexcept;
+
+    // Moves both waves one sample and applies the nut and bridge reflections.
+    // Without Fractional the read position is flat and whole for the block, and
+    // the bridge reads right(bridgeTap) directly
+    template <typename Loss, bool Tuned, bool Fractional>
+    inline void step(int bridgeTap) noexcept
+    {
+        // Left-going wave moves one step towards the nut; the slot it leaves behind
+        // becomes Left[L-1]. At the nut assume perfect reflection (*-1).
+        const SampleType leavingLeft = Left[leftHead];
+        leftHead = (leftHead + 1) & mask;
+        const SampleType nut = -Left[leftHead];
+
+        // Right-going wave moves one step towards the bridge, nut value prepended
+        rightHead = (rightHead - 1) & mask;
+        Right[rightHead] = nut;
+        const SampleType leavingRight = right(L);
+
+        // At the bridge reflect with coefficient r through the lumped loss filter
+        // into the end of the left-going line, reading the right rail at the
+        // (possibly fractional) bridge position
+        SampleType atBridge;
+
+        if constexpr (Fractional)
+        {
+            readOffset += readOffsetStep;
+            atBridge = readBridge(readOffset);
+        }
+        else
+        {
+            atBridge = right(bridgeTap);
+        }
+
+        SampleType reflected = Loss::process(loss, atBridge);
+
+        if constexpr (Tuned)
+        {
+            const SampleType out = tuningCoeff * reflected + tuningState;
+            tuningState = reflected - tuningCoeff * out;
+            reflected = out;
+        }
+
+        const SampleType bridge = -r * reflected;
+        left(L - 1) = bridge;
+
+        energy += (double)(nut * nut + bridge * bridge - leavingLeft * leavingLeft - leavingRight * leavingRight);
+    }
+
+    // Coupled bridge, one sample in two halves around a junction shared with other
+    // strings: the StringBank's coupled kernel, one string at a time, for strings
+    // the bank doesn't take. arriveAtBridge moves both waves and returns what
+    // reaches the bridge through the loss filter (as a full biquad, like the bank)
+    // and tuning; reflectAtBridge then sends back r times the bridge velocity, as
+    // seen by this string, less that wave. Ramps advance per sample, so call
+    // finishRamp() at the end of the block as process() would.
+    inline SampleType arriveAtBridge() noexcept
+    {
+        r += rStep;
+        loss.b0 += b0Step; loss.b1 += b1Step; loss.b2 += b2Step;
+        loss.a1 += a1Step; loss.a2 += a2Step;
+
+        const SampleType leavingLeft = Left[leftHead];
+        leftHead = (leftHead + 1) & mask;
+        const SampleType nut = -Left[leftHead];
+
+        rightHead = (rightHead - 1) & mask;
+        Right[rightHead] = nut;
+        const SampleType leavingRight = right(L);
+
+        readOffset += readOffsetStep;
+        const SampleType y = loss.process(readBridge(readOffset));
+
+        const SampleType tunedY = tuningCoeff * y + tuningState;
+        tuningState = y - tuningCoeff * tunedY;
+
+        arriving = tuned ? tunedY : y;
+        energy += (double)(nut * nut - leavingLeft * leavingLeft - leavingRight * leavingRight);
+
+        return arriving;
+    }
+
+    inline void reflectAtBridge(SampleType bridgeVelocity) noexcept
+    {
+        // Rigid bridge (velocity 0) is the uncoupled -r * arriving
+        const SampleType bridge = r * (bridgeVelocity - arriving);
+        left(L - 1) = bridge;
+        energy += (double)(bridge * bridge);
+    }
+
+    // Right rail at L-1+offset. Cubic Lagrange over the four nearest samples; at a
+    // whole-sample offset the weights are exactly 0, 1, 0, 0
+    inline SampleType readBridge(SampleType offset) noexcept
+    {
+        constexpr SampleType one = 1, two = 2, half = SampleType(0.5), sixth = SampleType(1) / SampleType(6);
+
+        const SampleType whole = std::floor(offset);
+        const SampleType d = offset - whole;
+        const int i = L - 1 + (int)whole;
+
+        const SampleType xm1 = right(i - 1), x0 = right(i), x1 = right(i + 1), x2 = right(i + 2);
+
+        return xm1 * (-d * (d - one) * (d - two) * sixth)
+             + x0 * ((d + one) * (d - one) * (d - two) * half)
+             + x1 * (-(d + one) * d * (d - two) * half)
+             + x2 * ((d + one) * d * (d - one) * sixth);
+    }
+
+    // Output is sum of left and right going delay lines at pickup point
+    inline SampleType pickupSample() noexcept { return left(pickup) + right(pickup); }
+
+    // Renders numSamples of pickup output into dest through the loop picked for
+    // this string's loss filter and tuning
+    void process(SampleType* dest, int numSamples) noexcept { (this->*renderer)(dest, numSamples); }
+
+private:
+    friend class StringBank;
+
+    template <typename Loss, bool Tuned>
+    void render(SampleType* dest, int numSamples) noexcept
+    {
+        // No bend or vibrato moving the read position and it sits on a whole sample
+        // (as it does at rest): the Lagrange weights would be 0, 1, 0, 0, so skip them
+        if (readOffsetStep == 0 && readOffset == std::floor(readOffset))
+            renderLoop<Loss, Tuned, false>(dest, numSamples);
+        else
+            renderLoop<Loss, Tuned, true>(dest, numSamples);
+
+        finishRamp();
+    }
+
+    template <typename Loss, bool Tuned, bool Fractional>
+    void renderLoop(SampleType* dest, int numSamples) noexcept
+    {
+        const int bridgeTap = Fractional ? 0 : L - 1 + (int)readOffset;
+
+        if (ramping)
+        {
+            for (int n = 0; n < numSamples; ++n)
+            {
+                r += rStep;
+                loss.b0 += b0Step; loss.b1 += b1Step; loss.b2 += b2Step;
+                loss.a1 += a1Step; loss.a2 += a2Step;
+
+                step<Loss, Tuned, Fractional>(bridgeTap);
+                dest[n] = pickupSample();
+            }
+
+            return;
+        }
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            step<Loss, Tuned, Fractional>(bridgeTap);
+            dest[n] = pickupSample();
+        }
+    }
+
+    // One render loop per loss filter and tuning combination, looked up when
+    // either changes (note-on), so process() costs one indirect call per block
+    using Renderer = void (WaveguideString::*)(SampleType*, int) noexcept;
+    void selectRenderer() noexcept;
+
+    Renderer renderer = &WaveguideString::render<BiQuadLoss, false>;
+
+    SampleType clampReadOffset(SampleType offset) const noexcept
+    {
+        // The four interpolation taps have to stay inside the rail
+        return juce::jlimit((SampleType)(2 - L), (SampleType)juce::jmax(0, capacity - L - 3), offset);
+    }
+
+    SampleType* Left = nullptr;
+    SampleType* Right = nullptr;
+    Filter loss;
+
+    int L = 0;
+    int capacity = 0;
+    int mask = 0;
+    int leftHead = 0, rightHead = 0;
+    int pickup = 0;
+
+    SampleType r = SampleType(0.94);
+
+    // Active ramp: per-sample increments and the exact values to land on
+    SampleType rStep = 0, b0Step = 0, b1Step = 0, b2Step = 0, a1Step = 0, a2Step = 0;
+    SampleType rTarget = SampleType(0.94);
+    Filter lossTarget;
+    bool ramping = false;
+
+    SampleType tuningCoeff = 0, tuningState = 0;
+    bool tuned = false;
+
+    SampleType arriving = 0;    // Coupled bridge: this sample's wave at the bridge
+
+    // Bridge read position relative to L-1, ramped per sample
+    SampleType readOffset = 0, readOffsetStep = 0, readOffsetTarget = 0;
+
+    double energy = 0.0;
+};
+
+//===============================================================================
+// One contiguous, pre-faulted slab holding both rails of every voice.
+//
+// Sized at prepareToPlay for the lowest playable note at the current sample
+// rate, so note-on never has to touch the heap. Only the precision the engine
+// is prepared for has one.
+//
+// The lowest note is A0, the bottom of a piano: MIDI 0 (8 Hz) would need four
+// times the rails for strings nobody hears (64 MB of float at 192 kHz with 256
+// voices). Bends below it are clamped to the rail like any other.
+//===============================================================================
+template <typename SampleType>
+class DelayLineArena
+{
+public:
+    static constexpr int lowestMidiNote = 21;
+
+    static int getRailCapacityFor(double sampleRate);
+
+    // Rebuilds the slab if the sample rate or voice count changed. Not for the audio thread.
+    bool prepare(double sampleRate, int numVoices);
+    void release();
+
+    SampleType* getLeftRail(int voiceIndex) noexcept  { return block.get() + (size_t)(2 * voiceIndex) * (size_t)railCapacity; }
+    SampleType* getRightRail(int voiceIndex) noexcept { return block.get() + (size_t)(2 * voiceIndex + 1) * (size_t)railCapacity; }
+
+    int getRailCapacity() const noexcept { return railCapacity; }
+    int getNumVoices() const noexcept { return numVoices; }
+
+    void swapWith(DelayLineArena& other) noexcept
+    {
+        block.swapWith(other.block);
+        std::swap(railCapacity, other.railCapacity);
+        std::swap(numVoices, other.numVoices);
+    }
+
+private:
+    juce::HeapBlock<SampleType> block;
+    int railCapacity = 0;
+    int numVoices = 0;
+};
@@ -0,0 +1,508 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 11:03:55am
+    Author:  josep
+
+    String engine micro-benchmarks. Sweeps note (L), sample rate, polyphony,
+    block size and loss filter and prints one row per case as CSV or JSON
+    lines, so runs from two builds can be diffed directly.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../Shared/AllocationCounter.h"
+#include "../../Shared/ScopedMessageManager.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double nanosecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    double percentile(std::vector<double>& values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+
+        std::sort(values.begin(), values.end());
+        const auto index = (size_t)juce::jlimit(0.0, (double)(values.size() - 1), std::round(p * (double)(values.size() - 1)));
+        return values[index];
+    }
+
+    juce::Array<int> parseList(const juce::String& text)
+    {
+        juce::Array<int> values;
+
+        for (auto& item : juce::StringArray::fromTokens(text, ",", ""))
+            values.add(item.getIntValue());
+
+        return values;
+    }
+
+    void setParameter(Physical_Model_StringAudioProcessor& processor, const juce::String& id, float value)
+    {
+        if (auto* param = processor.apvts.getParameter(id))
+            param->setValueNotifyingHost(param->convertTo0to1(value));
+    }
+
+    //===============================================================================
+    struct Case
+    {
+        juce::String bench, mode;
+        int note = 0, rate = 0, polyphony = 0, block = 0, loss = 0;
+    };
+
+    struct Row
+    {
+        Case c;
+        int L = 0;
+        double nsPerSample = 0.0, nsPerVoiceSample = 0.0;
+        double p50 = 0.0, p99 = 0.0, max = 0.0;
+        double maxLoad = 0.0;       // worst callback over the block's duration (process and body)
+        double allocsPerBlock = 0.0;
+        int activeVoices = 0;
+    };
+
+    class Reporter
+    {
+    public:
+        explicit Reporter(bool asJson) : json(asJson)
+        {
+            if (!json)
+                std::cout << "bench,mode,isa,note,L,rate,polyphony,block,loss,ns_per_sample,ns_per_voice_sample,"
+                             "p50_ns,p99_ns,max_ns,max_load,allocs_per_block,active_voices\n";
+        }
+
+        void add(const Row& r, const juce::String& isa)
+        {
+            if (json)
+            {
+                auto* obj = new juce::DynamicObject();
+                obj->setProperty("bench", r.c.bench);
+                obj->setProperty("mode", r.c.mode);
+                obj->setProperty("isa", isa);
+                obj->setProperty("note", r.c.note);
+                obj->setProperty("L", r.L);
+                obj->setProperty("rate", r.c.rate);
+                obj->setProperty("polyphony", r.c.polyphony);
+                obj->setProperty("block", r.c.block);
+                obj->setProperty("loss", r.c.loss);
+                obj->setProperty("ns_per_sample", r.nsPerSample);
+                obj->setProperty("ns_per_voice_sample", r.nsPerVoiceSample);
+                obj->setProperty("p50_ns", r.p50);
+                obj->setProperty("p99_ns", r.p99);
+                obj->setProperty("max_ns", r.max);
+                obj->setProperty("max_load", r.maxLoad);
+                obj->setProperty("allocs_per_block", r.allocsPerBlock);
+                obj->setProperty("active_voices", r.activeVoices);
+
+                std::cout << juce::JSON::toString(juce::var(obj), true) << "\n";
+            }
+            else
+            {
+                std::cout << r.c.bench << "," << r.c.mode << "," << isa << "," << r.c.note << "," << r.L << ","
+                          << r.c.rate << "," << r.c.polyphony << "," << r.c.block << "," << r.c.loss << ","
+                          << r.nsPerSample << "," << r.nsPerVoiceSample << ","
+                          << r.p50 << "," << r.p99 << "," << r.max << "," << r.maxLoad << ","
+                          << r.allocsPerBlock << "," << r.activeVoices << "\n";
+            }
+
+            std::cout.flush();
+        }
+
+    private:
+        bool json;
+    };
+
+    const char* isaName(StringBank::Isa isa)
+    {
+        switch (isa)
+        {
+            case StringBank::Isa::AVX512: return "avx512";
+            case StringBank::Isa::AVX2:   return "avx2";
+            case StringBank::Isa::SSE:    return "sse";
+            default:                      return "scalar";
+        }
+    }
+
+    //===============================================================================
+    // Voices held on distinct channel/note pairs around the base note so the
+    // Synthesiser doesn't retrigger one voice
+    void playChord(juce::Synthesiser& synth, int baseNote, int numNotes, std::vector<double>* noteOnTimes)
+    {
+        for (int i = 0; i < numNotes; i++)
+        {
+            const auto start = Clock::now();
+            synth.noteOn(1 + i % 16, juce::jlimit(0, 127, baseNote + i / 16), 0.8f);
+
+            if (noteOnTimes != nullptr)
+                noteOnTimes->push_back(nanosecondsSince(start));
+        }
+    }
+
+    struct EngineFixture
+    {
+        EngineFixture(const Case& c)
+        {
+            //Keep decayed strings alive so every block does the same work
+            setParameter(processor, "RetireThreshold", -160.0f);
+            setParameter(processor, "LossFilter", (float)c.loss);
+            setParameter(processor, "Sustain", 1.0f);
+            setParameter(processor, "VoiceModel", c.mode == "modal" ? 1.0f : 0.0f);
+            processor.publishParameterSnapshot();
+
+            synth.setVoiceFactory([this] { return new SynthVoice(&processor); });
+            synth.addSound(new SynthSound());
+            synth.setPolyphony(juce::jmax(StringSynthesiser::minPolyphony, c.polyphony));
+            synth.setLockstepRendering(c.mode == "bank" || c.mode == "coupled");
+            synth.setBridgeCoupling(c.mode == "coupled" ? 0.1f : 0.0f);
+            synth.prepare((double)c.rate, c.block, 2, c.mode == "double");
+        }
+
+        int countActiveVoices() const
+        {
+            int active = 0;
+
+            for (int i = 0; i < synth.getNumVoices(); i++)
+                if (synth.getVoice(i)->isVoiceActive())
+                    ++active;
+
+            return active;
+        }
+
+        Physical_Model_StringAudioProcessor processor;
+        StringSynthesiser synth;
+    };
+
+    //===============================================================================
+    // Total time for numBlocks renderNextBlock calls at one sample type
+    template <typename SampleType>
+    double timeVoiceBlocks(StringSynthesiser& synth, const Case& c, int numBlocks)
+    {
+        juce::AudioBuffer<SampleType> buffer(2, c.block);
+        juce::MidiBuffer midi;
+
+        // Warm up caches and the branch predictor
+        for (int i = 0; i < 8; i++)
+            synth.renderNextBlock(buffer, midi, 0, c.block);
+
+        ScopedAllocationCounter counter;
+        double totalNs = 0.0;
+
+        for (int i = 0; i < numBlocks; i++)
+        {
+            buffer.clear();
+            const auto start = Clock::now();
+            synth.renderNextBlock(buffer, midi, 0, c.block);
+            totalNs += nanosecondsSince(start);
+        }
+
+        return totalNs;
+    }
+
+    // renderNextBlock cost through the synthesiser, per voice-sample
+    Row runVoiceCase(const Case& c, double secondsOfAudio)
+    {
+        EngineFixture fixture(c);
+        auto& synth = fixture.synth;
+
+        playChord(synth, c.note, c.polyphony, nullptr);
+
+        const int numBlocks = juce::jmax(4, (int)(secondsOfAudio * c.rate / c.block));
+        const auto allocsBefore = allocationCount.load();
+        const double totalNs = c.mode == "double" ? timeVoiceBlocks<double>(synth, c, numBlocks)
+                                                  : timeVoiceBlocks<float>(synth, c, numBlocks);
+
+        Row row;
+        row.c = c;
+        row.L = (int)std::floor(c.rate / juce::MidiMessage::getMidiNoteInHertz(c.note));
+        row.activeVoices = fixture.countActiveVoices();
+        row.nsPerSample = totalNs / ((double)numBlocks * c.block);
+        row.nsPerVoiceSample = row.nsPerSample / juce::jmax(1, row.activeVoices);
+        row.allocsPerBlock = (double)(allocationCount.load() - allocsBefore) / numBlocks;
+        return row;
+    }
+
+    // startNote latency distribution, note-on/note-off cycles on a prepared synth
+    Row runNoteOnCase(const Case& c, int numNoteOns)
+    {
+        EngineFixture fixture(c);
+        auto& synth = fixture.synth;
+
+        juce::AudioBuffer<float> buffer(2, c.block);
+        juce::MidiBuffer midi;
+        std::vector<double> times;
+        times.reserve((size_t)numNoteOns);
+
+        const auto allocsBefore = allocationCount.load();
+
+        {
+            ScopedAllocationCounter counter;
+
+            for (int i = 0; i < numNoteOns; i++)
+            {
+                const auto start = Clock::now();
+                synth.noteOn(1, c.note, 0.8f);
+                times.push_back(nanosecondsSince(start));
+
+                synth.renderNextBlock(buffer, midi, 0, c.block);
+                synth.noteOff(1, c.note, 0.0f, false);
+            }
+        }
+
+        Row row;
+        row.c = c;
+        row.L = (int)std::floor(c.rate / juce::MidiMessage::getMidiNoteInHertz(c.note));
+        row.allocsPerBlock = (double)(allocationCount.load() - allocsBefore) / numNoteOns;
+        row.p50 = percentile(times, 0.5);
+        row.p99 = percentile(times, 0.99);
+        row.max = times.empty() ? 0.0 : times.back();
+        return row;
+    }
+
+    // Starts the chord, warms up, then times numBlocks processBlock calls
+    template <typename SampleType>
+    void timeProcessBlocks(Physical_Model_StringAudioProcessor& processor, const Case& c, int numBlocks, std::vector<double>& times)
+    {
+        juce::AudioBuffer<SampleType> buffer(2, c.block);
+        juce::MidiBuffer midi;
+
+        for (int i = 0; i < c.polyphony; i++)
+            midi.addEvent(juce::MidiMessage::noteOn(1 + i % 16, juce::jlimit(0, 127, c.note + i / 16), 0.8f), 0);
+
+        processor.processBlock(buffer, midi);
+        midi.clear();
+
+        for (int i = 0; i < 8; i++)
+            processor.processBlock(buffer, midi);
+
+        ScopedAllocationCounter counter;
+
+        for (int i = 0; i < numBlocks; i++)
+        {
+            const auto start = Clock::now();
+            processor.processBlock(buffer, midi);
+            times.push_back(nanosecondsSince(start));
+        }
+    }
+
+    // Whole processBlock (MIDI, synth, analysis taps) with a held chord, in the
+    // host precision the mode names
+    Row runProcessBlockCase(const Case& c, double secondsOfAudio)
+    {
+        const bool doublePrecision = c.mode == "double";
+
+        Physical_Model_StringAudioProcessor processor;
+        setParameter(processor, "RetireThreshold", -160.0f);
+        setParameter(processor, "LossFilter", (float)c.loss);
+        setParameter(processor, "Sustain", 1.0f);
+        setParameter(processor, "Polyphony", (float)juce::jmax(StringSynthesiser::minPolyphony, c.polyphony));
+        processor.applyEngineSettings();
+
+        processor.setPlayConfigDetails(0, 2, c.rate, c.block);
+        processor.setProcessingPrecision(doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                         : juce::AudioProcessor::singlePrecision);
+        processor.prepareToPlay(c.rate, c.block);
+
+        const int numBlocks = juce::jmax(4, (int)(secondsOfAudio * c.rate / c.block));
+        const auto allocsBefore = allocationCount.load();
+        std::vector<double> times;
+        times.reserve((size_t)numBlocks);
+
+        if (doublePrecision)
+            timeProcessBlocks<double>(processor, c, numBlocks, times);
+        else
+            timeProcessBlocks<float>(processor, c, numBlocks, times);
+
+        double totalNs = 0.0;
+        for (auto t : times)
+            totalNs += t;
+
+        Row row;
+        row.c = c;
+        row.L = (int)std::floor(c.rate / juce::MidiMessage::getMidiNoteInHertz(c.note));
+        row.activeVoices = c.polyphony;
+        row.nsPerSample = totalNs / ((double)numBlocks * c.block);
+        row.nsPerVoiceSample = row.nsPerSample / juce::jmax(1, c.polyphony);
+        row.allocsPerBlock = (double)(allocationCount.load() - allocsBefore) / numBlocks;
+        row.p50 = percentile(times, 0.5);
+        row.p99 = percentile(times, 0.99);
+        row.max = times.empty() ? 0.0 : times.back();
+        row.maxLoad = row.max / (1.0e9 * c.block / c.rate);
+
+        processor.releaseResources();
+        return row;
+    }
+
+    // Body convolution on its own: one stereo block of noise through a stereo IR
+    // of irMs milliseconds (decaying noise, like a real body response), so L is
+    // the IR length in samples here. The long segments do their FFT work spread
+    // over their own block, so max_ns/max_load is the number to watch, not the mean
+    Row runBodyCase(const Case& c, int irMs, double secondsOfAudio)
+    {
+        const int irLength = juce::jmax(1, (int)((double)c.rate * irMs / 1000.0));
+        juce::AudioBuffer<float> impulseResponse(2, irLength);
+        juce::Random random(1);
+
+        for (int channel = 0; channel < 2; channel++)
+            for (int i = 0; i < irLength; i++)
+                impulseResponse.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp(-6.9f * (float)i / (float)irLength));
+
+        BodyResonator body;
+        body.prepare(impulseResponse, (double)c.rate, (double)c.rate, c.block);
+
+        juce::AudioBuffer<float> buffer(2, c.block);
+
+        // At least a few of the largest segment's blocks, so its worst callback is in the run
+        const int numBlocks = juce::jmax(4 * 8192 / c.block + 1, (int)(secondsOfAudio * c.rate / c.block));
+        std::vector<double> times;
+        times.reserve((size_t)numBlocks);
+
+        auto fill = [&]
+        {
+            for (int i = 0; i < c.block; i++)
+                buffer.setSample(0, i, random.nextFloat() * 2.0f - 1.0f);
+
+            buffer.copyFrom(1, 0, buffer, 0, 0, c.block);
+        };
+
+        for (int i = 0; i < 8; i++)
+        {
+            fill();
+            body.process(buffer, c.block, 1.0f);
+        }
+
+        const auto allocsBefore = allocationCount.load();
+
+        {
+            ScopedAllocationCounter counter;
+
+            for (int i = 0; i < numBlocks; i++)
+            {
+                fill();
+                const auto start = Clock::now();
+                body.process(buffer, c.block, 1.0f);
+                times.push_back(nanosecondsSince(start));
+            }
+        }
+
+        double totalNs = 0.0;
+        for (auto t : times)
+            totalNs += t;
+
+        Row row;
+        row.c = c;
+        row.L = irLength;
+        row.nsPerSample = totalNs / ((double)numBlocks * c.block);
+        row.allocsPerBlock = (double)(allocationCount.load() - allocsBefore) / numBlocks;
+        row.p50 = percentile(times, 0.5);
+        row.p99 = percentile(times, 0.99);
+        row.max = times.empty() ? 0.0 : times.back();
+        row.maxLoad = row.max / (1.0e9 * c.block / c.rate);
+        return row;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: Benchmarks [options]\n"
+                     "  --bench <list>                 voice,noteon,process,body (default all)\n"
+                     "  --notes <list>                 MIDI notes (default 28,52,76,100)\n"
+                     "  --rates <list>                 sample rates (default 44100,96000,192000)\n"
+                     "  --poly <list>                  held notes (default 1,12,64)\n"
+                     "  --blocks <list>                block sizes (default 16,128,1024,4096)\n"
+                     "  --loss <list>                  loss filters 0=moving average 1=one pole 2=biquad 3=dispersion (default 0,1,2,3)\n"
+                     "  --ir <list>                    body IR lengths in ms (default 20,250,2000)\n"
+                     "  --seconds <s>                  audio rendered per case (default 0.25)\n"
+                     "  --json                         JSON lines instead of CSV\n";
+    }
+}
+
+//===============================================================================
+int main(int argc, char* argv[])
+{
+    ScopedMessageManager messageManager;
+
+    if (!mallocIsCounted())
+        std::cerr << "Only operator new is counted on this platform; allocs_per_block misses malloc/calloc/realloc\n";
+
+    juce::StringArray benches{ "voice", "noteon", "process", "body" };
+    juce::Array<int> notes{ 28, 52, 76, 100 };
+    juce::Array<int> rates{ 44100, 96000, 192000 };
+    juce::Array<int> polyphonies{ 1, 12, 64 };
+    juce::Array<int> blocks{ 16, 128, 1024, 4096 };
+    juce::Array<int> losses{ 0, 1, 2, 3 };
+    juce::Array<int> irLengths{ 20, 250, 2000 };
+    double seconds = 0.25;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--bench" && hasValue)        benches = juce::StringArray::fromTokens(argv[++i], ",", "");
+        else if (arg == "--notes" && hasValue)   notes = parseList(argv[++i]);
+        else if (arg == "--rates" && hasValue)   rates = parseList(argv[++i]);
+        else if (arg == "--poly" && hasValue)    polyphonies = parseList(argv[++i]);
+        else if (arg == "--blocks" && hasValue)  blocks = parseList(argv[++i]);
+        else if (arg == "--loss" && hasValue)    losses = parseList(argv[++i]);
+        else if (arg == "--ir" && hasValue)      irLengths = parseList(argv[++i]);
+        else if (arg == "--seconds" && hasValue) seconds = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--json")                json = true;
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    StringBank probe;
+    const juce::String isa = isaName(probe.getIsa());
+    Reporter reporter(json);
+
+    for (auto rate : rates)
+    {
+        if (benches.contains("body"))
+        {
+            for (auto irMs : irLengths)
+                for (auto block : blocks)
+                    reporter.add(runBodyCase({ "body", "partitioned", 0, rate, 0, block, 0 }, irMs, seconds), isa);
+        }
+
+        for (auto note : notes)
+        {
+            for (auto loss : losses)
+            {
+                if (benches.contains("noteon"))
+                    reporter.add(runNoteOnCase({ "noteon", "bank", note, rate, 1, 512, loss }, 1000), isa);
+
+                for (auto poly : polyphonies)
+                {
+                    for (auto block : blocks)
+                    {
+                        if (benches.contains("voice"))
+                        {
+                            for (auto* mode : { "bank", "coupled", "scalar", "double", "modal" })
+                                reporter.add(runVoiceCase({ "voice", mode, note, rate, poly, block, loss }, seconds), isa);
+                        }
+
+                        if (benches.contains("process"))
+                        {
+                            for (auto* mode : { "bank", "double" })
+                                reporter.add(runProcessBlockCase({ "process", mode, note, rate, poly, block, loss }, seconds), isa);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
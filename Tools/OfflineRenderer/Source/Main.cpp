@@ -0,0 +1,365 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 9:12:40am
+    Author:  josep
+
+    Headless renderer: Standard MIDI Files in, WAV/FLAC out, as fast as the
+    CPU allows. Each input file is rendered by its own processor instance on
+    a pool thread; finished blocks are handed to a background writer thread.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../Shared/ScopedMessageManager.h"
+
+namespace
+{
+    //===============================================================================
+    struct RenderSettings
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        double tailSeconds = 3.0;
+        int bitDepth = 24;
+        bool flac = false;
+        bool dumpCounters = false;
+
+        juce::File outputDirectory;
+        juce::File presetFile;
+        juce::File bodyFile;
+        juce::File bankFolder;
+        juce::StringPairArray parameterOverrides;
+    };
+
+    struct RenderResult
+    {
+        juce::File output;
+        double audioSeconds = 0.0;
+        double renderSeconds = 0.0;
+        bool ok = false;
+        juce::String error;
+        juce::String counters;
+    };
+
+    //===============================================================================
+    // Preset file is the APVTS state as XML (<Parameters><PARAM id=".." value=".."/>..)
+    bool loadParameters(Physical_Model_StringAudioProcessor& processor, const RenderSettings& settings, juce::String& error)
+    {
+        if (settings.presetFile != juce::File())
+        {
+            auto xml = juce::parseXML(settings.presetFile);
+
+            if (xml == nullptr)
+            {
+                error = "Couldn't read preset " + settings.presetFile.getFullPathName();
+                return false;
+            }
+
+            processor.apvts.replaceState(juce::ValueTree::fromXml(*xml));
+        }
+
+        for (auto& id : settings.parameterOverrides.getAllKeys())
+        {
+            auto* param = processor.apvts.getParameter(id);
+
+            if (param == nullptr)
+            {
+                error = "Unknown parameter " + id;
+                return false;
+            }
+
+            param->setValueNotifyingHost(param->convertTo0to1(settings.parameterOverrides[id].getFloatValue()));
+        }
+
+        if (settings.bodyFile != juce::File() && !processor.loadBodyImpulseResponse(settings.bodyFile))
+        {
+            error = "Couldn't read body IR " + settings.bodyFile.getFullPathName();
+            return false;
+        }
+
+        //Program changes in the MIDI file pick from this bank
+        if (settings.bankFolder != juce::File())
+        {
+            processor.loadPresetBank(settings.bankFolder);
+            processor.waitForPresetBank();
+        }
+
+        //No message loop here, so push polyphony etc. through directly
+        processor.applyEngineSettings();
+        return true;
+    }
+
+    bool loadMidi(const juce::File& file, juce::MidiMessageSequence& sequence, juce::String& error)
+    {
+        juce::FileInputStream in(file);
+        juce::MidiFile midiFile;
+
+        if (!in.openedOk() || !midiFile.readFrom(in))
+        {
+            error = "Couldn't read MIDI file " + file.getFullPathName();
+            return false;
+        }
+
+        midiFile.convertTimestampTicksToSeconds();
+
+        for (int track = 0; track < midiFile.getNumTracks(); track++)
+            sequence.addSequence(*midiFile.getTrack(track), 0.0);
+
+        sequence.updateMatchedPairs();
+        return true;
+    }
+
+    //===============================================================================
+    class RenderJob : public juce::ThreadPoolJob
+    {
+    public:
+        RenderJob(const juce::File& midi, const RenderSettings& s, juce::TimeSliceThread& writer, RenderResult& r)
+            : juce::ThreadPoolJob(midi.getFileName()), midiFile(midi), settings(s), writerThread(writer), result(r)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            result.ok = render(result.error);
+            return jobHasFinished;
+        }
+
+    private:
+        bool render(juce::String& error)
+        {
+            juce::MidiMessageSequence sequence;
+
+            if (!loadMidi(midiFile, sequence, error))
+                return false;
+
+            Physical_Model_StringAudioProcessor processor;
+
+            if (!loadParameters(processor, settings, error))
+                return false;
+
+            const double sampleRate = settings.sampleRate;
+            const int blockSize = settings.blockSize;
+
+            processor.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+            processor.prepareToPlay(sampleRate, blockSize);
+
+            result.output = settings.outputDirectory.getChildFile(midiFile.getFileNameWithoutExtension())
+                                                    .withFileExtension(settings.flac ? "flac" : "wav");
+            result.output.deleteFile();
+
+            std::unique_ptr<juce::AudioFormat> format;
+
+            if (settings.flac)
+                format = std::make_unique<juce::FlacAudioFormat>();
+            else
+                format = std::make_unique<juce::WavAudioFormat>();
+
+            auto stream = result.output.createOutputStream();
+
+            if (stream == nullptr)
+            {
+                error = "Couldn't create " + result.output.getFullPathName();
+                return false;
+            }
+
+            std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, 2,
+                                                                                    settings.bitDepth, {}, 0));
+
+            if (writer == nullptr)
+            {
+                error = "Unsupported output format/bit depth";
+                return false;
+            }
+
+            stream.release(); // now owned by the writer
+
+            //Blocks are queued here and written to disk on the shared writer thread
+            auto threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(writer.release(), writerThread, 1 << 17);
+
+            const juce::int64 totalSamples = (juce::int64)std::ceil((sequence.getEndTime() + settings.tailSeconds) * sampleRate);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::MidiBuffer midi;
+            int nextEvent = 0;
+
+            const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+            for (juce::int64 position = 0; position < totalSamples && !shouldExit(); position += blockSize)
+            {
+                const int numSamples = (int)juce::jmin((juce::int64)blockSize, totalSamples - position);
+
+                midi.clear();
+
+                while (nextEvent < sequence.getNumEvents())
+                {
+                    const auto& message = sequence.getEventPointer(nextEvent)->message;
+                    const auto eventSample = (juce::int64)std::llround(message.getTimeStamp() * sampleRate);
+
+                    if (eventSample >= position + numSamples)
+                        break;
+
+                    if (!message.isMetaEvent())
+                        midi.addEvent(message, (int)juce::jmax((juce::int64)0, eventSample - position));
+
+                    ++nextEvent;
+                }
+
+                buffer.setSize(2, numSamples, false, false, true);
+                processor.processBlock(buffer, midi);
+
+                while (!threadedWriter->write(buffer.getArrayOfReadPointers(), numSamples))
+                    juce::Thread::sleep(1);
+            }
+
+            result.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+            result.audioSeconds = (double)totalSamples / sampleRate;
+
+            threadedWriter.reset(); // flushes whatever is still queued
+
+            //Deadlines here are real time, so late blocks mean this file couldn't have played live
+            if (settings.dumpCounters)
+                result.counters = PerformanceCounters::describe(processor.getPerformanceCounters().getSnapshot());
+
+            processor.releaseResources();
+
+            return true;
+        }
+
+        juce::File midiFile;
+        const RenderSettings& settings;
+        juce::TimeSliceThread& writerThread;
+        RenderResult& result;
+    };
+
+    //===============================================================================
+    void printUsage()
+    {
+        std::cout << "Usage: OfflineRenderer [options] <file.mid> [<file.mid> ...]\n"
+                     "  --preset <file.xml>    parameter set (APVTS state XML)\n"
+                     "  --param <ID>=<value>   override one parameter, repeatable (e.g. BRC=-0.98)\n"
+                     "  --body <file.wav>      body impulse response (mono or stereo)\n"
+                     "  --bank <dir>           preset bank for MIDI program changes (.pms/.xml files)\n"
+                     "  --rate <Hz>            sample rate (default 48000)\n"
+                     "  --block <samples>      block size (default 512)\n"
+                     "  --tail <seconds>       render time after the last event (default 3)\n"
+                     "  --format wav|flac      output format (default wav)\n"
+                     "  --bits <16|24|32>      bit depth (default 24)\n"
+                     "  --out <dir>            output directory (default: next to each MIDI file)\n"
+                     "  --jobs <n>             files rendered concurrently (default: number of cores)\n"
+                     "  --counters             print each file's block load, late blocks, voice and note-on cost\n";
+    }
+}
+
+//===============================================================================
+int main(int argc, char* argv[])
+{
+    ScopedMessageManager messageManager;
+
+    RenderSettings settings;
+    juce::Array<juce::File> inputs;
+    int numJobs = juce::SystemStats::getNumCpus();
+
+    for (int i = 1; i < argc; i++)
+    {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--preset" && hasValue)      settings.presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--param" && hasValue)
+        {
+            const juce::String pair(argv[++i]);
+            settings.parameterOverrides.set(pair.upToFirstOccurrenceOf("=", false, false),
+                                            pair.fromFirstOccurrenceOf("=", false, false));
+        }
+        else if (arg == "--body" && hasValue)   settings.bodyFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--bank" && hasValue)   settings.bankFolder = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--rate" && hasValue)   settings.sampleRate = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--block" && hasValue)  settings.blockSize = juce::String(argv[++i]).getIntValue();
+        else if (arg == "--tail" && hasValue)   settings.tailSeconds = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--format" && hasValue) settings.flac = juce::String(argv[++i]).equalsIgnoreCase("flac");
+        else if (arg == "--bits" && hasValue)   settings.bitDepth = juce::String(argv[++i]).getIntValue();
+        else if (arg == "--out" && hasValue)    settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--jobs" && hasValue)   numJobs = juce::String(argv[++i]).getIntValue();
+        else if (arg == "--counters")           settings.dumpCounters = true;
+        else if (arg.startsWith("--"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            inputs.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+        }
+    }
+
+    if (inputs.isEmpty() || settings.sampleRate <= 0.0 || settings.blockSize <= 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    numJobs = juce::jlimit(1, juce::jmax(1, inputs.size()), numJobs);
+
+    juce::TimeSliceThread writerThread("Audio file writer");
+    writerThread.startThread();
+
+    std::vector<RenderResult> results((size_t)inputs.size());
+    std::vector<RenderSettings> perFileSettings((size_t)inputs.size(), settings);
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    {
+        juce::ThreadPool pool(numJobs);
+
+        for (int i = 0; i < inputs.size(); i++)
+        {
+            auto& fileSettings = perFileSettings[(size_t)i];
+
+            if (fileSettings.outputDirectory == juce::File())
+                fileSettings.outputDirectory = inputs[i].getParentDirectory();
+
+            pool.addJob(new RenderJob(inputs[i], fileSettings, writerThread, results[(size_t)i]), true);
+        }
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(10);
+    }
+
+    writerThread.stopThread(5000);
+
+    const double wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+    double totalAudioSeconds = 0.0;
+    int failures = 0;
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto& r = results[i];
+
+        if (!r.ok)
+        {
+            std::cout << "FAILED " << inputs[(int)i].getFileName() << ": " << r.error << "\n";
+            ++failures;
+            continue;
+        }
+
+        totalAudioSeconds += r.audioSeconds;
+
+        std::cout << r.output.getFullPathName() << "  "
+                  << juce::String(r.audioSeconds, 2) << " s audio in " << juce::String(r.renderSeconds, 3) << " s"
+                  << "  (RTF " << juce::String(r.renderSeconds / juce::jmax(1.0e-9, r.audioSeconds), 4)
+                  << ", " << juce::String(r.audioSeconds / juce::jmax(1.0e-9, r.renderSeconds), 1) << "x real time)\n";
+
+        if (r.counters.isNotEmpty())
+            std::cout << "    " << r.counters << "\n";
+    }
+
+    std::cout << "Total: " << juce::String(totalAudioSeconds, 2) << " s audio in " << juce::String(wallSeconds, 3)
+              << " s wall clock on " << numJobs << " thread(s), "
+              << juce::String(totalAudioSeconds / juce::jmax(1.0e-9, wallSeconds), 1) << "x real time\n";
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,574 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 18 Oct 2026 3:47:12pm
+    Author:  josep
+
+    Golden-render regression tests. Renders a fixed corpus of notes and
+    parameter sets through the processor and compares each one against its
+    stored reference render (bit-exact, or within the case's tolerance). The
+    same run checks each case against its CPU budget and fails if the audio
+    callback allocates.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../Shared/AllocationCounter.h"
+#include "../../Shared/ScopedMessageManager.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    //===============================================================================
+    struct Event
+    {
+        double time = 0.0;
+        juce::MidiMessage message;
+    };
+
+    struct Case
+    {
+        juce::String name;
+        double rate = 48000.0;
+        int block = 512;
+        double seconds = 2.0;
+        std::vector<std::pair<juce::String, float>> parameters;
+        std::vector<Event> events;
+
+        // Largest allowed |render - reference|, 0 = bit-exact
+        float tolerance = 0.0f;
+
+        // Fastest render of the case as a fraction of real time on one core
+        double cpuBudget = 0.05;
+
+        // Stereo decaying-noise body IR of this many ms, 0 = no body
+        int bodyMs = 0;
+
+        // Rendered as a double precision host would; the reference holds the
+        // result narrowed to float
+        bool doublePrecision = false;
+    };
+
+    void addNote(Case& c, double time, int note, float velocity, double duration, int channel = 1)
+    {
+        c.events.push_back({ time, juce::MidiMessage::noteOn(channel, note, velocity) });
+        c.events.push_back({ time + duration, juce::MidiMessage::noteOff(channel, note) });
+    }
+
+    void addChord(Case& c, double time, int baseNote, int numNotes, double duration)
+    {
+        for (int i = 0; i < numNotes; i++)
+            addNote(c, time, juce::jlimit(0, 127, baseNote + i / 16), 0.8f, duration, 1 + i % 16);
+    }
+
+    //===============================================================================
+    // The corpus. Adding a case is fine; changing one invalidates its reference,
+    // so regenerate that one with --update --case <name> and commit the new file.
+    //
+    // Cases that sum across SIMD lanes (modal) or go through the FFT (body) get a
+    // small tolerance, since the summation order follows the ISA picked at runtime.
+    // Everything else is per-lane and has to match exactly: the bank kernels are
+    // built without FMA contraction, so SSE, AVX2 and AVX-512 machines agree.
+    std::vector<Case> buildCorpus()
+    {
+        std::vector<Case> corpus;
+
+        {
+            Case c{ "pluck_default_48k" };
+            addNote(c, 0.0, 52, 0.8f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "pluck_near_bridge" };
+            c.parameters = { { "PluckPos", 0.2f }, { "BRC", -0.98f } };
+            addNote(c, 0.0, 40, 1.0f, 1.5);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "pluck_centre_soft_bridge" };
+            c.parameters = { { "PluckPos", 1.0f }, { "BRC", -0.9f } };
+            addNote(c, 0.0, 64, 0.6f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "adsr_swell_release" };
+            c.parameters = { { "Attack", 0.5f }, { "Decay", 0.4f }, { "Sustain", 0.4f }, { "Release", 0.3f } };
+            addNote(c, 0.1, 57, 0.8f, 1.2);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "moving_average_44k1" };
+            c.rate = 44100.0;
+            c.block = 441;
+            c.parameters = { { "LossFilter", 0.0f } };
+            addNote(c, 0.0, 45, 0.8f, 1.0);
+            addNote(c, 0.5, 52, 0.8f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "one_pole_96k" };
+            c.rate = 96000.0;
+            c.block = 1024;
+            c.parameters = { { "LossFilter", 1.0f }, { "LossCutoff", 6000.0f } };
+            addNote(c, 0.0, 76, 0.8f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "dispersion_stiff_string" };
+            c.parameters = { { "LossFilter", 3.0f }, { "Inharmonicity", 0.002f } };
+            addNote(c, 0.0, 33, 0.8f, 1.0);
+            addNote(c, 0.4, 57, 0.8f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "strike_excitation" };
+            c.parameters = { { "Excitation", 1.0f }, { "PluckPos", 0.3f } };
+            addNote(c, 0.0, 48, 0.8f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "noise_excitation" };
+            c.parameters = { { "Excitation", 2.0f } };
+            addNote(c, 0.0, 55, 0.8f, 1.0);
+            addNote(c, 0.3, 62, 0.6f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "adaptive_high_notes_192k" };
+            c.rate = 192000.0;
+            c.block = 256;
+            c.seconds = 1.0;
+            c.cpuBudget = 0.1;
+            c.parameters = { { "Quality", 1.0f } };
+            addNote(c, 0.0, 100, 0.8f, 0.5);
+            addNote(c, 0.25, 107, 0.8f, 0.5);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "chord_12_small_blocks" };
+            c.block = 32;
+            c.cpuBudget = 0.2;
+            addChord(c, 0.0, 40, 12, 1.5);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "repeated_notes_steal" };
+            c.parameters = { { "Polyphony", 4.0f } };
+
+            for (int i = 0; i < 16; i++)
+                addNote(c, i * 0.1, 48 + (i * 5) % 24, 0.5f + 0.03f * i, 0.3);
+
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "bend_and_vibrato" };
+            c.parameters = { { "PitchBendRange", 12.0f } };
+            addNote(c, 0.0, 52, 0.8f, 1.8);
+            c.events.push_back({ 0.3, juce::MidiMessage::pitchWheel(1, 16383) });
+            c.events.push_back({ 0.8, juce::MidiMessage::pitchWheel(1, 4096) });
+            c.events.push_back({ 1.0, juce::MidiMessage::controllerEvent(1, 1, 127) });
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "coupled_bridge" };
+            c.parameters = { { "BridgeCoupling", 0.1f } };
+            addChord(c, 0.0, 43, 6, 1.5);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "double_long_low_loss" };
+            c.seconds = 3.0;
+            c.doublePrecision = true;
+            c.parameters = { { "BRC", -0.999f }, { "Sustain", 1.0f } };
+            addNote(c, 0.0, 28, 0.8f, 2.5);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "modal_inharmonic" };
+            c.tolerance = 1.0e-5f;
+            c.parameters = { { "VoiceModel", 1.0f }, { "Inharmonicity", 0.01f } };
+            addNote(c, 0.0, 36, 0.8f, 1.0);
+            addNote(c, 0.4, 60, 0.8f, 1.0);
+            corpus.push_back(c);
+        }
+        {
+            Case c{ "body_250ms" };
+            c.tolerance = 1.0e-5f;
+            c.bodyMs = 250;
+            c.parameters = { { "BodyMix", 0.7f } };
+            addNote(c, 0.0, 48, 0.8f, 1.0);
+            corpus.push_back(c);
+        }
+
+        return corpus;
+    }
+
+    //===============================================================================
+    struct Render
+    {
+        juce::AudioBuffer<float> audio;
+        double bestSeconds = 0.0;
+        juce::int64 allocations = 0;
+    };
+
+    void setParameter(Physical_Model_StringAudioProcessor& processor, const juce::String& id, float value)
+    {
+        auto* param = processor.apvts.getParameter(id);
+        jassert(param != nullptr);   // corpus names a parameter that no longer exists
+
+        if (param != nullptr)
+            param->setValueNotifyingHost(param->convertTo0to1(value));
+    }
+
+    juce::AudioBuffer<float> makeBodyImpulse(double rate, int ms)
+    {
+        const int length = juce::jmax(1, (int)(rate * ms / 1000.0));
+        juce::AudioBuffer<float> impulseResponse(2, length);
+        juce::Random random(1);
+
+        for (int channel = 0; channel < 2; channel++)
+            for (int i = 0; i < length; i++)
+                impulseResponse.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp(-6.9f * (float)i / (float)length));
+
+        return impulseResponse;
+    }
+
+    // Runs every block through processBlock at the host precision SampleType and
+    // collects the output as float; returns the time spent in processBlock
+    template <typename SampleType>
+    double renderBlocks(Physical_Model_StringAudioProcessor& processor, const Case& c,
+                        std::vector<juce::MidiBuffer>& midi, juce::AudioBuffer<float>& output)
+    {
+        const int totalSamples = output.getNumSamples();
+        juce::AudioBuffer<SampleType> buffer(2, c.block);
+        double seconds = 0.0;
+
+        for (int b = 0; b < (int)midi.size(); b++)
+        {
+            const int position = b * c.block;
+            const int numSamples = juce::jmin(c.block, totalSamples - position);
+
+            buffer.setSize(2, numSamples, false, false, true);
+
+            const auto start = Clock::now();
+
+            {
+                ScopedAllocationCounter counter;
+                processor.processBlock(buffer, midi[(size_t)b]);
+            }
+
+            seconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+            for (int channel = 0; channel < 2; channel++)
+            {
+                const SampleType* source = buffer.getReadPointer(channel);
+                float* destination = output.getWritePointer(channel, position);
+
+                for (int n = 0; n < numSamples; n++)
+                    destination[n] = (float)source[n];
+            }
+        }
+
+        return seconds;
+    }
+
+    // One render on a fresh processor. MIDI for every block is built before the
+    // timed loop, so the only thing running under the counter is processBlock
+    void renderOnce(const Case& c, juce::AudioBuffer<float>& output, double& seconds, juce::int64& allocations)
+    {
+        Physical_Model_StringAudioProcessor processor;
+
+        for (auto& [id, value] : c.parameters)
+            setParameter(processor, id, value);
+
+        //No message loop here, so push polyphony etc. through directly
+        processor.applyEngineSettings();
+
+        if (c.bodyMs > 0)
+            processor.setBodyImpulseResponse(makeBodyImpulse(c.rate, c.bodyMs), c.rate);
+
+        processor.setPlayConfigDetails(0, 2, c.rate, c.block);
+        processor.setProcessingPrecision(c.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                           : juce::AudioProcessor::singlePrecision);
+        processor.prepareToPlay(c.rate, c.block);
+
+        const int totalSamples = (int)std::ceil(c.seconds * c.rate);
+        const int numBlocks = (totalSamples + c.block - 1) / c.block;
+
+        std::vector<juce::MidiBuffer> midi((size_t)numBlocks);
+
+        for (auto& event : c.events)
+        {
+            const int sample = (int)std::llround(event.time * c.rate);
+
+            if (juce::isPositiveAndBelow(sample, totalSamples))
+                midi[(size_t)(sample / c.block)].addEvent(event.message, sample % c.block);
+        }
+
+        output.setSize(2, totalSamples);
+
+        const auto allocsBefore = allocationCount.load();
+
+        seconds = c.doublePrecision ? renderBlocks<double>(processor, c, midi, output)
+                                    : renderBlocks<float>(processor, c, midi, output);
+
+        allocations = allocationCount.load() - allocsBefore;
+        processor.releaseResources();
+    }
+
+    // Every repeat must produce the same audio; the fastest one is the CPU figure
+    bool render(const Case& c, int repeats, Render& result, juce::String& error)
+    {
+        result.bestSeconds = std::numeric_limits<double>::max();
+        result.allocations = 0;
+
+        for (int r = 0; r < repeats; r++)
+        {
+            juce::AudioBuffer<float> audio;
+            double seconds = 0.0;
+            juce::int64 allocations = 0;
+
+            renderOnce(c, audio, seconds, allocations);
+
+            result.bestSeconds = juce::jmin(result.bestSeconds, seconds);
+            result.allocations += allocations;
+
+            if (r == 0)
+            {
+                result.audio = std::move(audio);
+            }
+            else if (audio.getNumSamples() != result.audio.getNumSamples()
+                  || std::memcmp(audio.getReadPointer(0), result.audio.getReadPointer(0), sizeof(float) * (size_t)audio.getNumSamples()) != 0
+                  || std::memcmp(audio.getReadPointer(1), result.audio.getReadPointer(1), sizeof(float) * (size_t)audio.getNumSamples()) != 0)
+            {
+                error = "not deterministic (repeat " + juce::String(r) + " differs from the first render)";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //===============================================================================
+    // References are 32-bit float WAV, so reading one back gives the exact samples
+    bool writeReference(const juce::File& file, const juce::AudioBuffer<float>& audio, double rate)
+    {
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), rate, 2, 32, {}, 0));
+
+        if (writer == nullptr)
+            return false;
+
+        stream.release(); // now owned by the writer
+        return writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples());
+    }
+
+    bool readReference(const juce::File& file, juce::AudioBuffer<float>& audio, double& rate)
+    {
+        auto stream = file.createInputStream();
+
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatReader> reader(format.createReaderFor(stream.release(), true));
+
+        if (reader == nullptr || reader->numChannels != 2)
+            return false;
+
+        rate = reader->sampleRate;
+        audio.setSize(2, (int)reader->lengthInSamples);
+        return reader->read(&audio, 0, audio.getNumSamples(), 0, true, true);
+    }
+
+    struct Difference
+    {
+        float maxError = 0.0f;
+        int firstSample = -1;   // first sample over the tolerance
+    };
+
+    Difference compare(const juce::AudioBuffer<float>& render, const juce::AudioBuffer<float>& reference, float tolerance)
+    {
+        Difference difference;
+
+        for (int channel = 0; channel < 2; channel++)
+        {
+            auto* a = render.getReadPointer(channel);
+            auto* b = reference.getReadPointer(channel);
+
+            for (int i = 0; i < render.getNumSamples(); i++)
+            {
+                // Compared as values, so the only thing bit-exact can't tell apart is -0 and +0.
+                // Written so a NaN on either side always fails
+                const float error = std::abs(a[i] - b[i]);
+
+                if (a[i] != b[i] && !(error <= tolerance) && (difference.firstSample < 0 || i < difference.firstSample))
+                    difference.firstSample = i;
+
+                difference.maxError = juce::jmax(difference.maxError, error);
+            }
+        }
+
+        return difference;
+    }
+
+    //===============================================================================
+    struct Options
+    {
+        juce::File references{ juce::File::getCurrentWorkingDirectory().getChildFile("References") };
+        juce::StringArray cases;
+        int repeats = 3;
+        double budgetScale = 1.0;
+        bool update = false;
+    };
+
+    // Returns true if the case passed (or its reference was written)
+    bool runCase(const Case& c, const Options& options)
+    {
+        Render result;
+        juce::String error;
+        const auto referenceFile = options.references.getChildFile(c.name).withFileExtension("wav");
+
+        const bool rendered = render(c, options.repeats, result, error);
+        const double cpu = result.bestSeconds / c.seconds;
+        juce::StringArray failures;
+
+        if (!rendered)
+        {
+            failures.add(error);
+        }
+        else if (options.update)
+        {
+            if (!writeReference(referenceFile, result.audio, c.rate))
+                failures.add("couldn't write " + referenceFile.getFullPathName());
+        }
+        else
+        {
+            juce::AudioBuffer<float> reference;
+            double referenceRate = 0.0;
+
+            if (!readReference(referenceFile, reference, referenceRate))
+            {
+                failures.add("no reference at " + referenceFile.getFullPathName());
+            }
+            else if (referenceRate != c.rate || reference.getNumSamples() != result.audio.getNumSamples())
+            {
+                failures.add("reference is " + juce::String(reference.getNumSamples()) + " samples at " + juce::String(referenceRate)
+                             + " Hz, render is " + juce::String(result.audio.getNumSamples()) + " at " + juce::String(c.rate));
+            }
+            else
+            {
+                const auto difference = compare(result.audio, reference, c.tolerance);
+
+                if (difference.firstSample >= 0)
+                    failures.add("max error " + juce::String(difference.maxError, 9) + " (tolerance " + juce::String(c.tolerance, 9)
+                                 + "), first at sample " + juce::String(difference.firstSample));
+            }
+        }
+
+        if (result.allocations > 0)
+            failures.add(juce::String(result.allocations) + " allocations in processBlock");
+
+        if (options.budgetScale > 0.0 && cpu > c.cpuBudget * options.budgetScale)
+            failures.add("CPU " + juce::String(cpu * 100.0, 2) + "% of real time over budget "
+                         + juce::String(c.cpuBudget * options.budgetScale * 100.0, 2) + "%");
+
+        const char* status = failures.isEmpty() ? (options.update ? "UPDATED" : "PASS") : "FAIL";
+
+        std::cout << juce::String(status).paddedRight(' ', 8) << c.name.paddedRight(' ', 28)
+                  << " cpu " << juce::String(cpu * 100.0, 3) << "%";
+
+        for (auto& failure : failures)
+            std::cout << "\n        " << failure;
+
+        std::cout << std::endl;
+        return failures.isEmpty();
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: RegressionTests [options]\n"
+                     "  --references <dir>             reference renders (default ./References)\n"
+                     "  --case <list>                  only these cases (default all)\n"
+                     "  --repeats <n>                  renders per case, fastest is timed (default 3)\n"
+                     "  --budget-scale <x>             multiply every CPU budget, 0 skips them (default 1)\n"
+                     "  --update                       write the renders as the new references\n"
+                     "  --list                         print the case names\n";
+    }
+}
+
+//===============================================================================
+int main(int argc, char* argv[])
+{
+    ScopedMessageManager messageManager;
+
+    Options options;
+    const auto corpus = buildCorpus();
+
+    for (int i = 1; i < argc; i++)
+    {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--references" && hasValue)        options.references = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--case" && hasValue)         options.cases = juce::StringArray::fromTokens(argv[++i], ",", "");
+        else if (arg == "--repeats" && hasValue)      options.repeats = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+        else if (arg == "--budget-scale" && hasValue) options.budgetScale = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--update")                   options.update = true;
+        else if (arg == "--list")
+        {
+            for (auto& c : corpus)
+                std::cout << c.name << "\n";
+
+            return 0;
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (options.update && !options.references.createDirectory())
+    {
+        std::cerr << "Couldn't create " << options.references.getFullPathName() << "\n";
+        return 1;
+    }
+
+    // A checkout without the references can't pass, so don't render anything
+    if (!options.update && !options.references.isDirectory())
+    {
+        std::cerr << "No reference renders at " << options.references.getFullPathName()
+                  << " (they're committed in Tools/RegressionTests/References)\n";
+        return 1;
+    }
+
+    if (!mallocIsCounted())
+        std::cout << "Only operator new is counted on this platform; malloc/calloc/realloc in processBlock go unseen\n\n";
+
+    int numRun = 0, numFailed = 0;
+
+    for (auto& c : corpus)
+    {
+        if (!options.cases.isEmpty() && !options.cases.contains(c.name))
+            continue;
+
+        ++numRun;
+
+        if (!runCase(c, options))
+            ++numFailed;
+    }
+
+    std::cout << "\n" << (numRun - numFailed) << "/" << numRun << " passed\n";
+    return numFailed == 0 && numRun > 0 ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.h
+    Created: 19 Oct 2026 2:40:18pm
+    Author:  josep
+
+    Heap allocation counting for the console tools. Replaces the global
+    operator new/delete and, where the platform lets us, malloc, calloc and
+    realloc too, so include it from exactly one file per executable.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_MAC
+ #include <malloc/malloc.h>
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+//===============================================================================
+// While a ScopedAllocationCounter is alive every allocation on every thread is
+// counted, so work the audio thread hands to the render workers counts as well.
+// JUCE's HeapBlock and AudioBuffer allocate with malloc/calloc/realloc rather
+// than new, so those are counted wherever they can be hooked: glibc (the
+// functions are defined here and forward to glibc's own) and macOS (the default
+// malloc zone is patched). Anywhere else only operator new is seen, which
+// mallocIsCounted() reports so a tool can say so.
+namespace
+{
+    std::atomic<juce::int64> allocationCount{ 0 };
+    std::atomic<bool> countingAllocations{ false };
+
+    struct ScopedAllocationCounter
+    {
+        ScopedAllocationCounter()  { countingAllocations.store(true); }
+        ~ScopedAllocationCounter() { countingAllocations.store(false); }
+    };
+
+    inline void countAllocation() noexcept
+    {
+        if (countingAllocations.load(std::memory_order_relaxed))
+            allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+//===============================================================================
+#if JUCE_LINUX && defined (__GLIBC__)
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void __libc_free(void*);
+
+    void* malloc(size_t size) noexcept                 { countAllocation(); return __libc_malloc(size); }
+    void* calloc(size_t count, size_t size) noexcept   { countAllocation(); return __libc_calloc(count, size); }
+    void* realloc(void* p, size_t size) noexcept       { countAllocation(); return __libc_realloc(p, size); }
+    void free(void* p) noexcept                        { __libc_free(p); }
+}
+
+namespace
+{
+    // operator new counts itself, so it goes straight to glibc
+    void* rawAlloc(std::size_t size) noexcept { return __libc_malloc(size); }
+    void rawFree(void* p) noexcept            { __libc_free(p); }
+    bool mallocIsCounted() noexcept           { return true; }
+}
+
+#elif JUCE_MAC
+
+namespace
+{
+    using ZoneMalloc = void* (*)(malloc_zone_t*, size_t);
+    using ZoneCalloc = void* (*)(malloc_zone_t*, size_t, size_t);
+    using ZoneRealloc = void* (*)(malloc_zone_t*, void*, size_t);
+
+    malloc_zone_t* defaultZone = nullptr;
+    ZoneMalloc zoneMalloc = nullptr;
+    ZoneCalloc zoneCalloc = nullptr;
+    ZoneRealloc zoneRealloc = nullptr;
+
+    void* countedZoneMalloc(malloc_zone_t* zone, size_t size)               { countAllocation(); return zoneMalloc(zone, size); }
+    void* countedZoneCalloc(malloc_zone_t* zone, size_t count, size_t size) { countAllocation(); return zoneCalloc(zone, count, size); }
+    void* countedZoneRealloc(malloc_zone_t* zone, void* p, size_t size)     { countAllocation(); return zoneRealloc(zone, p, size); }
+
+    bool hookDefaultZone() noexcept
+    {
+        defaultZone = malloc_default_zone();
+        zoneMalloc = defaultZone->malloc;
+        zoneCalloc = defaultZone->calloc;
+        zoneRealloc = defaultZone->realloc;
+
+        // The zone struct sits in a read-only page on recent systems
+        const auto pageSize = (uintptr_t)getpagesize();
+        auto* page = (void*)((uintptr_t)defaultZone & ~(pageSize - 1));
+
+        if (mprotect(page, pageSize, PROT_READ | PROT_WRITE) != 0)
+            return false;
+
+        defaultZone->malloc = countedZoneMalloc;
+        defaultZone->calloc = countedZoneCalloc;
+        defaultZone->realloc = countedZoneRealloc;
+
+        mprotect(page, pageSize, PROT_READ);
+        return true;
+    }
+
+    const bool zoneHooked = hookDefaultZone();
+
+    // operator new counts itself, so it skips the patched zone
+    void* rawAlloc(std::size_t size) noexcept { return zoneHooked ? zoneMalloc(defaultZone, size) : std::malloc(size); }
+    void rawFree(void* p) noexcept            { std::free(p); }
+    bool mallocIsCounted() noexcept           { return zoneHooked; }
+}
+
+#else
+
+namespace
+{
+    void* rawAlloc(std::size_t size) noexcept { return std::malloc(size); }
+    void rawFree(void* p) noexcept            { std::free(p); }
+    bool mallocIsCounted() noexcept           { return false; }
+}
+
+#endif
+
+//===============================================================================
+namespace
+{
+    void* countedNew(std::size_t size)
+    {
+        countAllocation();
+
+        if (auto* p = rawAlloc(size == 0 ? 1 : size))
+            return p;
+
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size)                                   { return countedNew(size); }
+void* operator new[](std::size_t size)                                 { return countedNew(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept   { try { return countedNew(size); } catch (...) { return nullptr; } }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { try { return countedNew(size); } catch (...) { return nullptr; } }
+void operator delete(void* p) noexcept                                 { rawFree(p); }
+void operator delete[](void* p) noexcept                               { rawFree(p); }
+void operator delete(void* p, std::size_t) noexcept                    { rawFree(p); }
+void operator delete[](void* p, std::size_t) noexcept                  { rawFree(p); }
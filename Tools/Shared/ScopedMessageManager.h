@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+
+    ScopedMessageManager.h
+    Created: 21 Oct 2026 11:05:32am
+    Author:  josep
+
+    What the console tools need from JUCE's startup instead of
+    ScopedJuceInitialiser_GUI: the processor's APVTS (a Timer) and its
+    AsyncUpdater want a MessageManager to exist, but nothing here opens a
+    window, so the platform's GUI (NSApplication, the X display) stays
+    untouched.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//===============================================================================
+// Makes the calling thread the message thread for its lifetime. No loop runs,
+// so timers and async updates never fire; the tools don't rely on either.
+struct ScopedMessageManager
+{
+    ScopedMessageManager()  { juce::MessageManager::getInstance(); }
+
+    ~ScopedMessageManager()
+    {
+        juce::DeletedAtShutdown::deleteAll();
+        juce::MessageManager::deleteInstance();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedMessageManager)
+};